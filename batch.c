@@ -0,0 +1,305 @@
+/*
+ * batch.c
+ *
+ * Thread pool + work stealing for the batch match runner (see batch.h).
+ *
+ * Each BatchStep() is one "round": the match array is split into equal
+ * contiguous ranges, one per worker, and every range is consumed in
+ * BATCH_CHUNK sized pieces through an atomic cursor. A worker first
+ * drains its own range, then walks the other workers' cursors and steals
+ * the chunks they have not claimed yet. The calling thread works as
+ * worker 0, so a single-threaded batch never touches the pool.
+ */
+
+#include "batch.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+#define BATCH_CHUNK 64 // Matches claimed per cursor bump
+#define CACHE_LINE 64
+
+// ---------------------------------------------------------------------
+//  Structs
+// ---------------------------------------------------------------------
+
+typedef struct
+{
+    GameState game;
+    unsigned int seed; // RandomInput state for both bots
+    long long ticks;
+    long long matches;
+    long long wins[MAX_PLAYERS];
+    long long ties;
+} MatchSlot;
+
+// One per worker, padded so cursors never share a cache line
+typedef struct
+{
+    _Alignas(CACHE_LINE) atomic_int next; // Next unclaimed match
+    int end;                              // One past the range
+} WorkRange;
+
+typedef struct
+{
+    BatchRunner *batch;
+    int index;
+} WorkerArg;
+
+struct BatchRunner
+{
+    MatchSlot *slots;
+    int matchCount;
+
+    WorkRange *ranges;
+    int threadCount;
+
+    pthread_t *threads;
+    WorkerArg *args;
+    pthread_mutex_t lock;
+    pthread_cond_t startCond;
+    pthread_cond_t doneCond;
+    long long round;  // Bumped to start a round
+    int running;      // Workers still busy in this round
+    bool quit;
+};
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void *WorkerMain(void *arg);
+static void RunRound(BatchRunner *batch, int self);
+static void StepMatch(MatchSlot *slot);
+
+// ---------------------------------------------------------------------
+//  BatchCreate / BatchDestroy
+// ---------------------------------------------------------------------
+BatchRunner *BatchCreate(const GameMap *map, int matchCount, int threadCount,
+                         unsigned int seed)
+{
+    if (threadCount <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = (cpus > 0) ? (int)cpus : 1;
+    }
+    if (seed == 0)
+        seed = 1;
+
+    BatchRunner *batch = calloc(1, sizeof(BatchRunner));
+    if (batch == NULL)
+        return NULL;
+
+    batch->matchCount = matchCount;
+    batch->threadCount = threadCount;
+    batch->slots = calloc((size_t)matchCount, sizeof(MatchSlot));
+    batch->ranges = aligned_alloc(CACHE_LINE, sizeof(WorkRange) * (size_t)threadCount);
+    batch->threads = calloc((size_t)threadCount, sizeof(pthread_t));
+    batch->args = calloc((size_t)threadCount, sizeof(WorkerArg));
+    if (batch->slots == NULL || batch->ranges == NULL ||
+        batch->threads == NULL || batch->args == NULL)
+    {
+        free(batch->args);
+        free(batch->slots);
+        free(batch->ranges);
+        free(batch->threads);
+        free(batch);
+        return NULL;
+    }
+
+    for (int i = 0; i < matchCount; i++)
+    {
+        InitGame(&batch->slots[i].game, map, DEFAULT_PLAYERS);
+        // Spread seeds so neighbouring matches diverge immediately
+        batch->slots[i].seed = seed + (unsigned int)i * 2654435761u;
+        if (batch->slots[i].seed == 0)
+            batch->slots[i].seed = 1;
+    }
+
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->startCond, NULL);
+    pthread_cond_init(&batch->doneCond, NULL);
+
+    // Worker 0 is the caller of BatchStep(), only start the rest
+    for (int w = 1; w < threadCount; w++)
+    {
+        batch->args[w].batch = batch;
+        batch->args[w].index = w;
+        if (pthread_create(&batch->threads[w], NULL, WorkerMain, &batch->args[w]) != 0)
+        {
+            batch->threadCount = w;
+            BatchDestroy(batch);
+            return NULL;
+        }
+    }
+
+    return batch;
+}
+
+void BatchDestroy(BatchRunner *batch)
+{
+    if (batch == NULL)
+        return;
+
+    pthread_mutex_lock(&batch->lock);
+    batch->quit = true;
+    pthread_cond_broadcast(&batch->startCond);
+    pthread_mutex_unlock(&batch->lock);
+
+    for (int w = 1; w < batch->threadCount; w++)
+        pthread_join(batch->threads[w], NULL);
+
+    pthread_cond_destroy(&batch->doneCond);
+    pthread_cond_destroy(&batch->startCond);
+    pthread_mutex_destroy(&batch->lock);
+
+    free(batch->args);
+    free(batch->threads);
+    free(batch->ranges);
+    free(batch->slots);
+    free(batch);
+}
+
+// ---------------------------------------------------------------------
+//  BatchStep
+//    Hand out this round's ranges, wake the pool, work as worker 0,
+//    then wait for the stragglers
+// ---------------------------------------------------------------------
+void BatchStep(BatchRunner *batch)
+{
+    int per = (batch->matchCount + batch->threadCount - 1) / batch->threadCount;
+    for (int w = 0; w < batch->threadCount; w++)
+    {
+        int begin = w * per;
+        int end = begin + per;
+        if (begin > batch->matchCount)
+            begin = batch->matchCount;
+        if (end > batch->matchCount)
+            end = batch->matchCount;
+        atomic_store_explicit(&batch->ranges[w].next, begin, memory_order_relaxed);
+        batch->ranges[w].end = end;
+    }
+
+    if (batch->threadCount > 1)
+    {
+        pthread_mutex_lock(&batch->lock);
+        batch->running = batch->threadCount - 1;
+        batch->round++;
+        pthread_cond_broadcast(&batch->startCond);
+        pthread_mutex_unlock(&batch->lock);
+    }
+
+    RunRound(batch, 0);
+
+    if (batch->threadCount > 1)
+    {
+        pthread_mutex_lock(&batch->lock);
+        while (batch->running > 0)
+            pthread_cond_wait(&batch->doneCond, &batch->lock);
+        pthread_mutex_unlock(&batch->lock);
+    }
+}
+
+static void *WorkerMain(void *arg)
+{
+    WorkerArg *worker = arg;
+    BatchRunner *batch = worker->batch;
+    long long seen = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&batch->lock);
+        while (!batch->quit && batch->round == seen)
+            pthread_cond_wait(&batch->startCond, &batch->lock);
+        if (batch->quit)
+        {
+            pthread_mutex_unlock(&batch->lock);
+            return NULL;
+        }
+        seen = batch->round;
+        pthread_mutex_unlock(&batch->lock);
+
+        RunRound(batch, worker->index);
+
+        pthread_mutex_lock(&batch->lock);
+        if (--batch->running == 0)
+            pthread_cond_signal(&batch->doneCond);
+        pthread_mutex_unlock(&batch->lock);
+    }
+}
+
+// ---------------------------------------------------------------------
+//  RunRound
+//    Drain our own range first, then steal from the others
+// ---------------------------------------------------------------------
+static void RunRound(BatchRunner *batch, int self)
+{
+    for (int k = 0; k < batch->threadCount; k++)
+    {
+        WorkRange *range = &batch->ranges[(self + k) % batch->threadCount];
+
+        for (;;)
+        {
+            int begin = atomic_fetch_add_explicit(&range->next, BATCH_CHUNK,
+                                                  memory_order_relaxed);
+            if (begin >= range->end)
+                break;
+
+            int end = begin + BATCH_CHUNK;
+            if (end > range->end)
+                end = range->end;
+            for (int i = begin; i < end; i++)
+                StepMatch(&batch->slots[i]);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+//  StepMatch
+//    One tick of one duel; score and restart it when it ends
+// ---------------------------------------------------------------------
+static void StepMatch(MatchSlot *slot)
+{
+    InputFrame input;
+    RandomInput(&slot->seed, &input, slot->game.playerCount);
+    SimStep(&slot->game, &input);
+    slot->ticks++;
+
+    if (slot->game.gameOver)
+    {
+        int winner = MatchWinner(&slot->game);
+        if (winner < 0)
+            slot->ties++;
+        else
+            slot->wins[winner]++;
+
+        slot->matches++;
+        InitGame(&slot->game, slot->game.map, slot->game.playerCount);
+    }
+}
+
+// ---------------------------------------------------------------------
+//  Stats
+// ---------------------------------------------------------------------
+void BatchGetStats(const BatchRunner *batch, BatchStats *stats)
+{
+    *stats = (BatchStats){0};
+    for (int i = 0; i < batch->matchCount; i++)
+    {
+        const MatchSlot *slot = &batch->slots[i];
+        stats->ticks += slot->ticks;
+        stats->matches += slot->matches;
+        for (int p = 0; p < MAX_PLAYERS; p++)
+            stats->wins[p] += slot->wins[p];
+        stats->ties += slot->ties;
+    }
+}
+
+int BatchThreadCount(const BatchRunner *batch)
+{
+    return batch->threadCount;
+}
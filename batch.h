@@ -0,0 +1,42 @@
+/*
+ * batch.h
+ *
+ * Batch match runner: owns an array of independent GameStates (one per
+ * bot-vs-bot duel) and advances all of them together on a pool of worker
+ * threads. Matches are handed out in small chunks; a worker that runs out
+ * of its own chunks steals from the other workers, so a few slow matches
+ * never leave cores idle.
+ *
+ * Finished matches are scored and immediately restarted, so the batch
+ * keeps every slot busy for the whole tournament.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "simulation.h"
+
+typedef struct BatchRunner BatchRunner;
+
+typedef struct
+{
+    long long ticks;            // Match ticks simulated (all slots)
+    long long matches;          // Matches that reached gameOver
+    long long wins[MAX_PLAYERS];
+    long long ties;
+} BatchStats;
+
+// Every match is played on `map`, which must outlive the runner.
+// threadCount <= 0 picks one worker per online CPU.
+// Returns NULL on allocation or thread start failure.
+BatchRunner *BatchCreate(const GameMap *map, int matchCount, int threadCount,
+                         unsigned int seed);
+void BatchDestroy(BatchRunner *batch);
+
+// Advance every match by one tick; returns when all of them are done.
+void BatchStep(BatchRunner *batch);
+
+void BatchGetStats(const BatchRunner *batch, BatchStats *stats);
+int BatchThreadCount(const BatchRunner *batch);
+
+#endif // BATCH_H
@@ -0,0 +1,486 @@
+/*
+ * bot.c
+ *
+ * Monte Carlo Tree Search computer player (see bot.h).
+ *
+ * One playout: copy the root state, walk down the tree picking moves
+ * by UCB1 (each step one SimStep with random input for the others),
+ * add a level of children at the first node that has been visited but
+ * not expanded, play random input from there, and add the score to
+ * every node on the way down. Trees live in a fixed node pool per
+ * thread; a full pool only stops the tree from growing.
+ */
+
+#include "bot.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+#define BOT_MOVES 9
+#define BOT_ACTIONS (2 * BOT_MOVES) // Every move, without and with fire
+#define BOT_MAX_NODES (1 << 16)     // Per tree
+#define BOT_MAX_DEPTH 16            // Tree levels (ticks) below the root
+#define BOT_EXPLORATION 1.4f        // UCB1 constant, about sqrt(2)
+#define CACHE_LINE 64
+
+// Keys of each move: standing still, then the 8 directions
+static const unsigned char moveKeys[BOT_MOVES] = {
+    0,
+    INPUT_UP,
+    INPUT_DOWN,
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    INPUT_UP | INPUT_LEFT,
+    INPUT_UP | INPUT_RIGHT,
+    INPUT_DOWN | INPUT_LEFT,
+    INPUT_DOWN | INPUT_RIGHT,
+};
+
+// ---------------------------------------------------------------------
+//  Structs
+// ---------------------------------------------------------------------
+
+// The children of a node are BOT_ACTIONS consecutive nodes, in action
+// order, so a node only needs to know where they start
+typedef struct
+{
+    int children; // First child, 0 = not expanded (0 is the root)
+    int visits;
+    float value;  // Sum of the playout scores
+} Node;
+
+// One per thread, padded so their counters never share a cache line
+typedef struct
+{
+    _Alignas(CACHE_LINE) Bot *bot;
+    int index;
+    Node *nodes;
+    int nodeCount;
+    GameState *game; // Playout scratch
+    unsigned int seed;
+    long long playouts;
+    long long ticks;
+    int deepest;
+} Searcher;
+
+struct Bot
+{
+    BotConfig config;
+    Searcher *searchers;
+    int threadCount;
+
+    // The search in progress
+    const GameState *root;
+    double deadline;
+
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t startCond;
+    pthread_cond_t doneCond;
+    long long round;  // Bumped to start a search
+    int running;      // Threads still searching
+    bool quit;
+
+    BotStats stats;
+};
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void *SearcherMain(void *arg);
+static void Search(Searcher *searcher);
+static void Playout(Searcher *searcher);
+static int SelectAction(Searcher *searcher, const Node *parent);
+static void Advance(Searcher *searcher, int action);
+static float Score(const GameState *game, int player);
+static unsigned char ActionKeys(int action);
+static unsigned int NextRandom(unsigned int *seed);
+static double Now(void);
+
+// ---------------------------------------------------------------------
+//  BotDefaultConfig / BotCreate / BotDestroy
+// ---------------------------------------------------------------------
+void BotDefaultConfig(BotConfig *config, int player)
+{
+    config->player = player;
+    config->budget = DEFAULT_BOT_BUDGET;
+    config->playouts = 0;
+    config->threads = 0;
+    config->rolloutTicks = DEFAULT_BOT_ROLLOUT;
+    config->seed = 1;
+}
+
+Bot *BotCreate(const BotConfig *config)
+{
+    if (config->player < 0 || config->player >= MAX_PLAYERS ||
+        config->budget < 0.0 || config->playouts < 0 || config->rolloutTicks < 0 ||
+        (config->budget == 0.0 && config->playouts == 0))
+        return NULL;
+
+    int threadCount = config->threads;
+    if (threadCount <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = (cpus > 0) ? (int)cpus : 1;
+    }
+
+    Bot *bot = calloc(1, sizeof(Bot));
+    if (bot == NULL)
+        return NULL;
+
+    bot->config = *config;
+    bot->threadCount = threadCount;
+    bot->searchers = aligned_alloc(CACHE_LINE, sizeof(Searcher) * (size_t)threadCount);
+    bot->threads = calloc((size_t)threadCount, sizeof(pthread_t));
+    if (bot->searchers == NULL || bot->threads == NULL)
+    {
+        free(bot->threads);
+        free(bot->searchers);
+        free(bot);
+        return NULL;
+    }
+    memset(bot->searchers, 0, sizeof(Searcher) * (size_t)threadCount);
+
+    pthread_mutex_init(&bot->lock, NULL);
+    pthread_cond_init(&bot->startCond, NULL);
+    pthread_cond_init(&bot->doneCond, NULL);
+
+    // Searcher 0 is the caller of BotThink(), only start the rest
+    bot->threadCount = 0;
+    for (int t = 0; t < threadCount; t++)
+    {
+        Searcher *searcher = &bot->searchers[t];
+        searcher->bot = bot;
+        searcher->index = t;
+        // Spread seeds so the trees differ from the first playout
+        searcher->seed = config->seed + (unsigned int)t * 2654435761u;
+        if (searcher->seed == 0)
+            searcher->seed = 1;
+        searcher->nodes = malloc(sizeof(Node) * BOT_MAX_NODES);
+        searcher->game = malloc(sizeof(GameState));
+        bool started = searcher->nodes != NULL && searcher->game != NULL &&
+                       (t == 0 || pthread_create(&bot->threads[t], NULL, SearcherMain, searcher) == 0);
+        if (!started)
+        {
+            free(searcher->game);
+            free(searcher->nodes);
+            BotDestroy(bot);
+            return NULL;
+        }
+        bot->threadCount++;
+    }
+
+    return bot;
+}
+
+void BotDestroy(Bot *bot)
+{
+    if (bot == NULL)
+        return;
+
+    pthread_mutex_lock(&bot->lock);
+    bot->quit = true;
+    pthread_cond_broadcast(&bot->startCond);
+    pthread_mutex_unlock(&bot->lock);
+
+    for (int t = 1; t < bot->threadCount; t++)
+        pthread_join(bot->threads[t], NULL);
+
+    pthread_cond_destroy(&bot->doneCond);
+    pthread_cond_destroy(&bot->startCond);
+    pthread_mutex_destroy(&bot->lock);
+
+    for (int t = 0; t < bot->threadCount; t++)
+    {
+        free(bot->searchers[t].game);
+        free(bot->searchers[t].nodes);
+    }
+    free(bot->threads);
+    free(bot->searchers);
+    free(bot);
+}
+
+// ---------------------------------------------------------------------
+//  BotThink
+//    Wake the pool, search as thread 0, wait for the others, then add
+//    up the visits of the first moves over every tree
+// ---------------------------------------------------------------------
+unsigned char BotThink(Bot *bot, const GameState *game)
+{
+    int player = bot->config.player;
+    if (game->gameOver || player >= game->playerCount || game->ships[player].sunk)
+        return 0;
+
+    double start = Now();
+    bot->root = game;
+    bot->deadline = start + bot->config.budget;
+
+    if (bot->threadCount > 1)
+    {
+        pthread_mutex_lock(&bot->lock);
+        bot->running = bot->threadCount - 1;
+        bot->round++;
+        pthread_cond_broadcast(&bot->startCond);
+        pthread_mutex_unlock(&bot->lock);
+    }
+
+    Search(&bot->searchers[0]);
+
+    if (bot->threadCount > 1)
+    {
+        pthread_mutex_lock(&bot->lock);
+        while (bot->running > 0)
+            pthread_cond_wait(&bot->doneCond, &bot->lock);
+        pthread_mutex_unlock(&bot->lock);
+    }
+
+    // Most visited, ties to the better mean
+    int best = 0;
+    long long bestVisits = -1;
+    double bestValue = 0.0;
+    for (int a = 0; a < BOT_ACTIONS; a++)
+    {
+        long long visits = 0;
+        double value = 0.0;
+        for (int t = 0; t < bot->threadCount; t++)
+        {
+            const Searcher *searcher = &bot->searchers[t];
+            int children = searcher->nodes[0].children;
+            if (children == 0)
+                continue;
+            visits += searcher->nodes[children + a].visits;
+            value += searcher->nodes[children + a].value;
+        }
+        if (visits > bestVisits ||
+            (visits == bestVisits && visits > 0 && value / (double)visits > bestValue))
+        {
+            best = a;
+            bestVisits = visits;
+            bestValue = (visits > 0) ? value / (double)visits : 0.0;
+        }
+    }
+
+    double seconds = Now() - start;
+    bot->stats.thinks++;
+    bot->stats.seconds += seconds;
+    if (seconds > bot->stats.slowest)
+        bot->stats.slowest = seconds;
+    return ActionKeys(best);
+}
+
+static void *SearcherMain(void *arg)
+{
+    Searcher *searcher = arg;
+    Bot *bot = searcher->bot;
+    long long seen = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&bot->lock);
+        while (!bot->quit && bot->round == seen)
+            pthread_cond_wait(&bot->startCond, &bot->lock);
+        if (bot->quit)
+        {
+            pthread_mutex_unlock(&bot->lock);
+            return NULL;
+        }
+        seen = bot->round;
+        pthread_mutex_unlock(&bot->lock);
+
+        Search(searcher);
+
+        pthread_mutex_lock(&bot->lock);
+        if (--bot->running == 0)
+            pthread_cond_signal(&bot->doneCond);
+        pthread_mutex_unlock(&bot->lock);
+    }
+}
+
+// ---------------------------------------------------------------------
+//  Search
+//    A fresh tree every tick, played out until the budget is spent or
+//    the playout count reached (at least once either way)
+// ---------------------------------------------------------------------
+static void Search(Searcher *searcher)
+{
+    const BotConfig *config = &searcher->bot->config;
+    memset(&searcher->nodes[0], 0, sizeof(Node));
+    searcher->nodeCount = 1;
+
+    for (int n = 0;; n++)
+    {
+        if (n > 0 && config->playouts > 0 && n >= config->playouts)
+            break;
+        if (n > 0 && config->budget > 0.0 && Now() >= searcher->bot->deadline)
+            break;
+        Playout(searcher);
+    }
+}
+
+static void Playout(Searcher *searcher)
+{
+    const Bot *bot = searcher->bot;
+    GameState *game = searcher->game;
+    CopyGameState(game, bot->root);
+
+    // Down the tree while its nodes have been played out before,
+    // expanding the first one that has no children yet
+    int path[BOT_MAX_DEPTH + 1];
+    int depth = 0;
+    int node = 0;
+    path[0] = 0;
+    while (depth < BOT_MAX_DEPTH && !game->gameOver)
+    {
+        Node *current = &searcher->nodes[node];
+        if (current->children == 0)
+        {
+            if ((node != 0 && current->visits == 0) ||
+                searcher->nodeCount + BOT_ACTIONS > BOT_MAX_NODES)
+                break;
+            current->children = searcher->nodeCount;
+            memset(&searcher->nodes[current->children], 0, sizeof(Node) * BOT_ACTIONS);
+            searcher->nodeCount += BOT_ACTIONS;
+        }
+
+        int action = SelectAction(searcher, current);
+        Advance(searcher, action);
+        node = current->children + action;
+        path[++depth] = node;
+    }
+    if (depth > searcher->deepest)
+        searcher->deepest = depth;
+
+    // Everyone random from here
+    int t = 0;
+    for (; t < bot->config.rolloutTicks && !game->gameOver; t++)
+    {
+        InputFrame input;
+        RandomInput(&searcher->seed, &input, game->playerCount);
+        SimStep(game, &input);
+    }
+
+    float score = Score(game, bot->config.player);
+    for (int d = 0; d <= depth; d++)
+    {
+        searcher->nodes[path[d]].visits++;
+        searcher->nodes[path[d]].value += score;
+    }
+    searcher->playouts++;
+    searcher->ticks += depth + t;
+}
+
+// UCB1. Untried moves come first, taken from a random one on so that
+// ties do not always go to standing still.
+static int SelectAction(Searcher *searcher, const Node *parent)
+{
+    const Node *children = &searcher->nodes[parent->children];
+    int offset = (int)(NextRandom(&searcher->seed) % BOT_ACTIONS);
+    for (int k = 0; k < BOT_ACTIONS; k++)
+    {
+        int a = (offset + k) % BOT_ACTIONS;
+        if (children[a].visits == 0)
+            return a;
+    }
+
+    float logVisits = logf((float)parent->visits);
+    int best = 0;
+    float bestBound = -1.0f;
+    for (int a = 0; a < BOT_ACTIONS; a++)
+    {
+        float visits = (float)children[a].visits;
+        float bound = children[a].value / visits +
+                      BOT_EXPLORATION * sqrtf(logVisits / visits);
+        if (bound > bestBound)
+        {
+            best = a;
+            bestBound = bound;
+        }
+    }
+    return best;
+}
+
+// One tick with `action` for the bot and random input for the others
+static void Advance(Searcher *searcher, int action)
+{
+    InputFrame input;
+    RandomInput(&searcher->seed, &input, searcher->game->playerCount);
+    input.keys[searcher->bot->config.player] = ActionKeys(action);
+    SimStep(searcher->game, &input);
+}
+
+// 1 for a win, 0 for a loss (or sunk), 0.5 for a tie. Before the end,
+// 0.5 plus a quarter of the hp lead over the strongest other ship (in
+// starting hp), so a playout that ends never outweighs one that won.
+static float Score(const GameState *game, int player)
+{
+    if (game->gameOver)
+    {
+        int winner = MatchWinner(game);
+        if (winner == player)
+            return 1.0f;
+        return (winner < 0) ? 0.5f : 0.0f;
+    }
+
+    int hp = game->ships[player].hp;
+    if (hp <= 0)
+        return 0.0f;
+
+    int strongest = 0;
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        if (i != player && game->ships[i].hp > strongest)
+            strongest = game->ships[i].hp;
+    }
+    return 0.5f + 0.25f * (float)(hp - strongest) / (float)SHIP_HP;
+}
+
+static unsigned char ActionKeys(int action)
+{
+    unsigned char keys = moveKeys[action % BOT_MOVES];
+    return (action >= BOT_MOVES) ? (unsigned char)(keys | INPUT_FIRE) : keys;
+}
+
+static unsigned int NextRandom(unsigned int *seed)
+{
+    unsigned int x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// ---------------------------------------------------------------------
+//  Stats
+// ---------------------------------------------------------------------
+void BotGetStats(const Bot *bot, BotStats *stats)
+{
+    *stats = bot->stats;
+    for (int t = 0; t < bot->threadCount; t++)
+    {
+        const Searcher *searcher = &bot->searchers[t];
+        stats->playouts += searcher->playouts;
+        stats->ticks += searcher->ticks;
+        if (searcher->deepest > stats->deepest)
+            stats->deepest = searcher->deepest;
+    }
+}
+
+int BotThreadCount(const Bot *bot)
+{
+    return bot->threadCount;
+}
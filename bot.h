@@ -0,0 +1,69 @@
+/*
+ * bot.h
+ *
+ * Computer player: steers one ship by Monte Carlo Tree Search over
+ * copies of the GameState. Every tick it searches from the current
+ * state until its time budget is spent and answers with the keys of
+ * the most visited first move.
+ *
+ * The tree is over the bot's own moves only (9 directions, each with
+ * or without firing), one level per tick. The other players, and the
+ * bot itself past the tree, play random input (RandomInput), so a
+ * node stands for a sequence of own moves and its value averages over
+ * what everyone else might do. A playout ends a few dozen ticks after
+ * the tree, or at gameOver, scored 1 for a win, 0 for a loss and by
+ * the hp lead in between.
+ *
+ * Searches run on a small thread pool, one tree per thread from the
+ * same root (root parallelism): no locks while searching, and the
+ * trees' visit counts are added up for the answer. The calling thread
+ * searches too, so a one-thread bot starts no threads.
+ */
+
+#ifndef BOT_H
+#define BOT_H
+
+#include "simulation.h"
+
+#define DEFAULT_BOT_BUDGET 0.002 // Seconds of search per tick
+#define DEFAULT_BOT_ROLLOUT 24   // Random ticks played after the tree
+
+typedef struct Bot Bot;
+
+typedef struct
+{
+    int player;        // The ship it steers
+    double budget;     // Seconds per BotThink, 0 = only count playouts
+    int playouts;      // Per thread and BotThink, 0 = only the budget
+    int threads;       // <= 0 picks one per online CPU
+    int rolloutTicks;
+    unsigned int seed;
+} BotConfig;
+
+typedef struct
+{
+    long long thinks;     // BotThink calls that searched
+    long long playouts;   // All threads
+    long long ticks;      // SimSteps the playouts took
+    double seconds;       // Wall time spent in BotThink
+    double slowest;       // Longest single BotThink
+    int deepest;          // Deepest tree path, in ticks
+} BotStats;
+
+// Sets every field to its default, for `player`
+void BotDefaultConfig(BotConfig *config, int player);
+
+// Returns NULL if the config is out of range (it needs a budget or a
+// playout count) or memory or threads run out
+Bot *BotCreate(const BotConfig *config);
+void BotDestroy(Bot *bot);
+
+// The keys (INPUT_* bits) for the bot's ship on the tick after `game`.
+// With a budget this returns about `budget` seconds later; with only
+// a playout count it is deterministic for a given seed.
+unsigned char BotThink(Bot *bot, const GameState *game);
+
+void BotGetStats(const Bot *bot, BotStats *stats);
+int BotThreadCount(const Bot *bot);
+
+#endif // BOT_H
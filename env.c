@@ -0,0 +1,450 @@
+/*
+ * env.c
+ *
+ * Vectorized reinforcement-learning environment (see env.h).
+ *
+ * Every EnvStepBatch() splits the matches into one contiguous range per
+ * thread; a match costs about the same every tick, so there is nothing
+ * to steal. Each thread writes only its own matches' parts of the bound
+ * buffers. The calling thread works the first range, as in batch.c.
+ */
+
+#include "env.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------
+//  Structs
+// ---------------------------------------------------------------------
+
+typedef struct
+{
+    GameState game;
+    int tick;          // Ticks into the current match
+    long long episodes;
+    long long timeouts;
+    long long ties;
+    long long wins[MAX_PLAYERS];
+} MatchSlot;
+
+typedef struct
+{
+    Env *env;
+    int index;
+} WorkerArg;
+
+struct Env
+{
+    EnvConfig config;
+    EnvBuffers buffers;
+    size_t floats;      // Per agent observation
+    GameMap *map;
+    float *solid;       // The solid plane, as written by EnvReset
+    MatchSlot *slots;
+    long long steps;
+
+    int threadCount;
+    pthread_t *threads;
+    WorkerArg *args;
+    pthread_mutex_t lock;
+    pthread_cond_t startCond;
+    pthread_cond_t doneCond;
+    long long round;  // Bumped to start a step
+    int running;      // Workers still busy in this step
+    bool quit;
+};
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void *WorkerMain(void *arg);
+static void StepRange(Env *env, int worker);
+static void StepMatch(Env *env, int m);
+static void Observe(const Env *env, int m, bool solid);
+static void WriteFeatures(const Env *env, const MatchSlot *slot, int agent, float *features);
+
+// ---------------------------------------------------------------------
+//  EnvDefaultConfig / EnvObservationFloats
+// ---------------------------------------------------------------------
+void EnvDefaultConfig(EnvConfig *config)
+{
+    config->matchCount = 1024;
+    config->players = DEFAULT_PLAYERS;
+    config->mapWidth = DEFAULT_MAP_WIDTH;
+    config->mapHeight = DEFAULT_MAP_HEIGHT;
+    config->maxTicks = 600;
+    config->planes = true;
+    config->threads = 0;
+}
+
+size_t EnvObservationFloats(const EnvConfig *config)
+{
+    size_t planes = config->planes
+                        ? (size_t)ENV_PLANES * (size_t)config->mapWidth * (size_t)config->mapHeight
+                        : 0;
+    return planes + ENV_FEATURES;
+}
+
+// ---------------------------------------------------------------------
+//  EnvCreate / EnvDestroy
+// ---------------------------------------------------------------------
+Env *EnvCreate(const EnvConfig *config, const EnvBuffers *buffers)
+{
+    if (config->matchCount <= 0 || config->players < 2 || config->players > MAX_PLAYERS ||
+        config->maxTicks <= 0 || buffers->actions == NULL || buffers->observations == NULL ||
+        buffers->rewards == NULL || buffers->dones == NULL)
+        return NULL;
+
+    int threadCount = config->threads;
+    if (threadCount <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = (cpus > 0) ? (int)cpus : 1;
+    }
+    if (threadCount > config->matchCount)
+        threadCount = config->matchCount;
+
+    Env *env = calloc(1, sizeof(Env));
+    if (env == NULL)
+        return NULL;
+
+    env->config = *config;
+    env->buffers = *buffers;
+    env->floats = EnvObservationFloats(config);
+    env->map = MapCreate(config->mapWidth, config->mapHeight);
+    env->slots = calloc((size_t)config->matchCount, sizeof(MatchSlot));
+    env->threads = calloc((size_t)threadCount, sizeof(pthread_t));
+    env->args = calloc((size_t)threadCount, sizeof(WorkerArg));
+    size_t cells = (size_t)config->mapWidth * (size_t)config->mapHeight;
+    env->solid = malloc(sizeof(float) * cells);
+    if (env->map == NULL || env->slots == NULL || env->threads == NULL ||
+        env->args == NULL || env->solid == NULL)
+    {
+        free(env->solid);
+        free(env->args);
+        free(env->threads);
+        free(env->slots);
+        MapFree(env->map);
+        free(env);
+        return NULL;
+    }
+
+    for (int y = 0; y < config->mapHeight; y++)
+        for (int x = 0; x < config->mapWidth; x++)
+            env->solid[(size_t)y * config->mapWidth + x] = SolidAt(env->map, x, y) ? 1.0f : 0.0f;
+
+    pthread_mutex_init(&env->lock, NULL);
+    pthread_cond_init(&env->startCond, NULL);
+    pthread_cond_init(&env->doneCond, NULL);
+
+    // Worker 0 is the caller of EnvStepBatch(), only start the rest
+    env->threadCount = threadCount;
+    for (int w = 1; w < threadCount; w++)
+    {
+        env->args[w].env = env;
+        env->args[w].index = w;
+        if (pthread_create(&env->threads[w], NULL, WorkerMain, &env->args[w]) != 0)
+        {
+            env->threadCount = w;
+            EnvDestroy(env);
+            return NULL;
+        }
+    }
+
+    EnvReset(env);
+    return env;
+}
+
+void EnvDestroy(Env *env)
+{
+    if (env == NULL)
+        return;
+
+    pthread_mutex_lock(&env->lock);
+    env->quit = true;
+    pthread_cond_broadcast(&env->startCond);
+    pthread_mutex_unlock(&env->lock);
+
+    for (int w = 1; w < env->threadCount; w++)
+        pthread_join(env->threads[w], NULL);
+
+    pthread_cond_destroy(&env->doneCond);
+    pthread_cond_destroy(&env->startCond);
+    pthread_mutex_destroy(&env->lock);
+
+    free(env->solid);
+    free(env->args);
+    free(env->threads);
+    free(env->slots);
+    MapFree(env->map);
+    free(env);
+}
+
+// ---------------------------------------------------------------------
+//  EnvReset
+// ---------------------------------------------------------------------
+void EnvReset(Env *env)
+{
+    int players = env->config.players;
+    for (int m = 0; m < env->config.matchCount; m++)
+    {
+        InitGame(&env->slots[m].game, env->map, players);
+        env->slots[m].tick = 0;
+        Observe(env, m, true);
+    }
+
+    size_t agents = (size_t)env->config.matchCount * (size_t)players;
+    memset(env->buffers.rewards, 0, sizeof(float) * agents);
+    memset(env->buffers.dones, ENV_RUNNING, (size_t)env->config.matchCount);
+}
+
+// ---------------------------------------------------------------------
+//  EnvStepBatch
+//    Wake the pool, step the first range, wait for the others
+// ---------------------------------------------------------------------
+void EnvStepBatch(Env *env)
+{
+    if (env->threadCount > 1)
+    {
+        pthread_mutex_lock(&env->lock);
+        env->running = env->threadCount - 1;
+        env->round++;
+        pthread_cond_broadcast(&env->startCond);
+        pthread_mutex_unlock(&env->lock);
+    }
+
+    StepRange(env, 0);
+
+    if (env->threadCount > 1)
+    {
+        pthread_mutex_lock(&env->lock);
+        while (env->running > 0)
+            pthread_cond_wait(&env->doneCond, &env->lock);
+        pthread_mutex_unlock(&env->lock);
+    }
+    env->steps++;
+}
+
+static void *WorkerMain(void *arg)
+{
+    WorkerArg *worker = arg;
+    Env *env = worker->env;
+    long long seen = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&env->lock);
+        while (!env->quit && env->round == seen)
+            pthread_cond_wait(&env->startCond, &env->lock);
+        if (env->quit)
+        {
+            pthread_mutex_unlock(&env->lock);
+            return NULL;
+        }
+        seen = env->round;
+        pthread_mutex_unlock(&env->lock);
+
+        StepRange(env, worker->index);
+
+        pthread_mutex_lock(&env->lock);
+        if (--env->running == 0)
+            pthread_cond_signal(&env->doneCond);
+        pthread_mutex_unlock(&env->lock);
+    }
+}
+
+static void StepRange(Env *env, int worker)
+{
+    int per = (env->config.matchCount + env->threadCount - 1) / env->threadCount;
+    int begin = worker * per;
+    int end = begin + per;
+    if (end > env->config.matchCount)
+        end = env->config.matchCount;
+    for (int m = begin; m < end; m++)
+        StepMatch(env, m);
+}
+
+// ---------------------------------------------------------------------
+//  StepMatch
+//    One tick, its rewards, and a restart if it ended the match
+// ---------------------------------------------------------------------
+static void StepMatch(Env *env, int m)
+{
+    MatchSlot *slot = &env->slots[m];
+    GameState *game = &slot->game;
+    int players = env->config.players;
+    float *rewards = env->buffers.rewards + (size_t)m * (size_t)players;
+
+    InputFrame input;
+    memcpy(input.keys, env->buffers.actions + (size_t)m * (size_t)players, (size_t)players);
+    for (int i = 0; i < players; i++)
+        rewards[i] = (float)(game->ships[i].hp > 0 ? game->ships[i].hp : 0);
+
+    SimStep(game, &input);
+    slot->tick++;
+
+    // rewards[] held the hp before the tick; hp lost past 0 is not counted
+    float lostTotal = 0.0f;
+    for (int i = 0; i < players; i++)
+    {
+        float after = (float)(game->ships[i].hp > 0 ? game->ships[i].hp : 0);
+        rewards[i] -= after;
+        lostTotal += rewards[i];
+    }
+    for (int i = 0; i < players; i++)
+    {
+        float lost = rewards[i];
+        rewards[i] = ENV_REWARD_HP * ((lostTotal - lost) / (float)(players - 1) - lost);
+    }
+
+    unsigned char done = ENV_RUNNING;
+    if (game->gameOver)
+    {
+        int winner = MatchWinner(game);
+        if (winner < 0)
+        {
+            slot->ties++;
+        }
+        else
+        {
+            slot->wins[winner]++;
+            for (int i = 0; i < players; i++)
+                rewards[i] += (i == winner) ? ENV_REWARD_WIN : -ENV_REWARD_WIN;
+        }
+        done = ENV_DONE_OVER;
+    }
+    else if (slot->tick >= env->config.maxTicks)
+    {
+        slot->timeouts++;
+        done = ENV_DONE_TIMEOUT;
+    }
+
+    env->buffers.dones[m] = done;
+    if (done != ENV_RUNNING)
+    {
+        slot->episodes++;
+        InitGame(game, env->map, players);
+        slot->tick = 0;
+    }
+    Observe(env, m, false);
+}
+
+// ---------------------------------------------------------------------
+//  Observations
+// ---------------------------------------------------------------------
+static void Observe(const Env *env, int m, bool solid)
+{
+    const MatchSlot *slot = &env->slots[m];
+    const GameState *game = &slot->game;
+    int players = env->config.players;
+    int width = env->map->width;
+    size_t cells = (size_t)width * (size_t)env->map->height;
+    float *obs = env->buffers.observations + (size_t)m * (size_t)players * env->floats;
+
+    for (int a = 0; a < players; a++, obs += env->floats)
+    {
+        if (!env->config.planes)
+        {
+            WriteFeatures(env, slot, a, obs);
+            continue;
+        }
+
+        if (solid)
+            memcpy(obs + ENV_PLANE_SOLID * cells, env->solid, sizeof(float) * cells);
+        memset(obs + ENV_PLANE_SELF * cells, 0, sizeof(float) * 3 * cells);
+
+        for (int i = 0; i < players; i++)
+        {
+            const Ship *ship = &game->ships[i];
+            if (ship->sunk)
+                continue;
+            size_t plane = (i == a) ? ENV_PLANE_SELF : ENV_PLANE_OTHERS;
+            obs[plane * cells + (size_t)ship->y * width + ship->x] += 1.0f;
+        }
+
+        const ProjectileStore *store = &game->projectiles;
+        float *shots = obs + ENV_PLANE_PROJECTILES * cells;
+        for (int i = 0; i < store->count; i++)
+            shots[(size_t)store->y[i] * width + store->x[i]] += 1.0f;
+
+        WriteFeatures(env, slot, a, obs + ENV_PLANES * cells);
+    }
+}
+
+static void WriteFeatures(const Env *env, const MatchSlot *slot, int agent, float *features)
+{
+    const GameState *game = &slot->game;
+    const Ship *ship = &game->ships[agent];
+    float scaleX = 1.0f / (float)(env->map->width - 1);
+    float scaleY = 1.0f / (float)(env->map->height - 1);
+
+    features[ENV_FEATURE_X] = (float)ship->x * scaleX;
+    features[ENV_FEATURE_Y] = (float)ship->y * scaleY;
+    features[ENV_FEATURE_HP] = (float)(ship->hp > 0 ? ship->hp : 0) / (float)SHIP_HP;
+    features[ENV_FEATURE_VX] = (float)ship->vx;
+    features[ENV_FEATURE_VY] = (float)ship->vy;
+    features[ENV_FEATURE_AMMO] = (float)game->projectiles.inFlight[agent] / (float)MAX_PROJECTILES;
+
+    // Nearest by squared distance, lowest index on ties
+    int nearest = -1;
+    int nearestDistance = 0;
+    int afloat = 0;
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *other = &game->ships[i];
+        if (i == agent || other->sunk)
+            continue;
+        afloat++;
+        int dx = other->x - ship->x;
+        int dy = other->y - ship->y;
+        int distance = dx * dx + dy * dy;
+        if (nearest < 0 || distance < nearestDistance)
+        {
+            nearest = i;
+            nearestDistance = distance;
+        }
+    }
+
+    if (nearest >= 0)
+    {
+        const Ship *other = &game->ships[nearest];
+        features[ENV_FEATURE_NEAREST_DX] = (float)(other->x - ship->x) * scaleX;
+        features[ENV_FEATURE_NEAREST_DY] = (float)(other->y - ship->y) * scaleY;
+        features[ENV_FEATURE_NEAREST_HP] = (float)other->hp / (float)SHIP_HP;
+    }
+    else
+    {
+        features[ENV_FEATURE_NEAREST_DX] = 0.0f;
+        features[ENV_FEATURE_NEAREST_DY] = 0.0f;
+        features[ENV_FEATURE_NEAREST_HP] = 0.0f;
+    }
+    features[ENV_FEATURE_AFLOAT] = (float)afloat / (float)(game->playerCount - 1);
+    features[ENV_FEATURE_TIME] = (float)slot->tick / (float)env->config.maxTicks;
+}
+
+// ---------------------------------------------------------------------
+//  Stats
+// ---------------------------------------------------------------------
+void EnvGetStats(const Env *env, EnvStats *stats)
+{
+    memset(stats, 0, sizeof(EnvStats));
+    stats->steps = env->steps;
+    stats->ticks = env->steps * env->config.matchCount;
+    for (int m = 0; m < env->config.matchCount; m++)
+    {
+        const MatchSlot *slot = &env->slots[m];
+        stats->episodes += slot->episodes;
+        stats->timeouts += slot->timeouts;
+        stats->ties += slot->ties;
+        for (int p = 0; p < env->config.players; p++)
+            stats->wins[p] += slot->wins[p];
+    }
+}
+
+int EnvThreadCount(const Env *env)
+{
+    return env->threadCount;
+}
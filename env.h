@@ -0,0 +1,123 @@
+/*
+ * env.h
+ *
+ * Reinforcement-learning environment: a vector of independent matches
+ * stepped together, every ship of every match an agent (self-play).
+ * The caller owns every buffer (EnvBuffers) and binds them once at
+ * EnvCreate: each step reads the actions from one contiguous array and
+ * writes observations, rewards and done flags straight into the others,
+ * so a trainer sharing them (numpy arrays over ctypes, say) never has
+ * anything copied for it. Matches are split over a thread pool.
+ *
+ * Agent k of match m is index m * players + k everywhere. Its action
+ * is one byte of INPUT_* bits; its observation is EnvObservationFloats
+ * floats:
+ *
+ *    planes (unless config.planes is off), ENV_PLANES x height x width:
+ *       ENV_PLANE_SOLID        1 on '#' and 'X'
+ *       ENV_PLANE_SELF         1 on the agent's ship
+ *       ENV_PLANE_OTHERS       other ships afloat on the cell
+ *       ENV_PLANE_PROJECTILES  projectiles in flight on the cell
+ *    then ENV_FEATURES floats, see ENV_FEATURE_*
+ *
+ * The solid plane never changes, so only EnvReset writes it: steps
+ * leave it as it is in the bound buffer.
+ *
+ * Rewards: ENV_REWARD_HP per hp the agent lost this tick (negative),
+ * plus the same per hp the other ships lost on average (so a duel is
+ * zero-sum), and at the end ENV_REWARD_WIN to the winner and minus that
+ * to everyone else (0 for a tie or a timeout).
+ *
+ * A match that ended is restarted within the same step: its done flag
+ * says why, its rewards are for the tick that ended it, and its
+ * observations already show the new match.
+ */
+
+#ifndef ENV_H
+#define ENV_H
+
+#include <stddef.h>
+
+#include "simulation.h"
+
+#define ENV_PLANES 4
+#define ENV_PLANE_SOLID 0
+#define ENV_PLANE_SELF 1
+#define ENV_PLANE_OTHERS 2
+#define ENV_PLANE_PROJECTILES 3
+
+// Features, positions scaled to 0 .. 1 by the map size
+#define ENV_FEATURE_X 0
+#define ENV_FEATURE_Y 1
+#define ENV_FEATURE_HP 2          // Of SHIP_HP
+#define ENV_FEATURE_VX 3
+#define ENV_FEATURE_VY 4
+#define ENV_FEATURE_AMMO 5        // Projectiles in flight, of MAX_PROJECTILES
+#define ENV_FEATURE_NEAREST_DX 6  // Nearest other ship afloat, relative
+#define ENV_FEATURE_NEAREST_DY 7
+#define ENV_FEATURE_NEAREST_HP 8
+#define ENV_FEATURE_AFLOAT 9      // Other ships afloat, of playerCount - 1
+#define ENV_FEATURE_TIME 10       // Ticks played, of maxTicks
+#define ENV_FEATURES 11
+
+#define ENV_REWARD_HP 0.1f
+#define ENV_REWARD_WIN 1.0f
+
+// Done flags, one byte per match
+#define ENV_RUNNING 0
+#define ENV_DONE_OVER 1    // gameOver
+#define ENV_DONE_TIMEOUT 2 // Reached maxTicks first (truncated)
+
+typedef struct Env Env;
+
+typedef struct
+{
+    int matchCount;
+    int players;           // Ships per match, 2 .. MAX_PLAYERS
+    int mapWidth, mapHeight;
+    int maxTicks;          // Per match before it times out
+    bool planes;           // Occupancy planes in the observations
+    int threads;           // <= 0 picks one per online CPU
+} EnvConfig;
+
+typedef struct
+{
+    const unsigned char *actions; // matchCount * players
+    float *observations;          // matchCount * players * EnvObservationFloats
+    float *rewards;               // matchCount * players
+    unsigned char *dones;         // matchCount
+} EnvBuffers;
+
+typedef struct
+{
+    long long steps;    // EnvStepBatch calls
+    long long ticks;    // Match ticks (steps * matchCount)
+    long long episodes; // Matches ended
+    long long timeouts; // ... by maxTicks
+    long long ties;
+    long long wins[MAX_PLAYERS];
+} EnvStats;
+
+// Sets every field to its default: 1024 duels on the default map,
+// planes on, 600 ticks a match
+void EnvDefaultConfig(EnvConfig *config);
+
+// Floats of one agent's observation under `config`
+size_t EnvObservationFloats(const EnvConfig *config);
+
+// Returns NULL if the config is out of range or memory or threads run
+// out. The buffers must stay valid until EnvDestroy.
+Env *EnvCreate(const EnvConfig *config, const EnvBuffers *buffers);
+void EnvDestroy(Env *env);
+
+// Start every match over: observations (solid plane included) of the
+// first tick, rewards 0, dones ENV_RUNNING
+void EnvReset(Env *env);
+
+// Advance every match by one tick with the bound actions
+void EnvStepBatch(Env *env);
+
+void EnvGetStats(const Env *env, EnvStats *stats);
+int EnvThreadCount(const Env *env);
+
+#endif // ENV_H
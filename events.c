@@ -0,0 +1,74 @@
+/*
+ * events.c
+ *
+ * Binary min-heap event queue (see events.h).
+ */
+
+#include "events.h"
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static bool Before(ScheduledEvent a, ScheduledEvent b);
+
+// ---------------------------------------------------------------------
+//  EventQueueInit
+// ---------------------------------------------------------------------
+void EventQueueInit(EventQueue *queue, ScheduledEvent *storage, int capacity)
+{
+    queue->capacity = capacity;
+    queue->count = 0;
+    queue->heap = storage;
+}
+
+// ---------------------------------------------------------------------
+//  EventPush / EventPop
+//    The new event sifts up from the end; the last one sifts down from
+//    the top into the popped event's place
+// ---------------------------------------------------------------------
+bool EventPush(EventQueue *queue, int tick, int id)
+{
+    if (queue->count == queue->capacity)
+        return false;
+
+    ScheduledEvent event = {tick, id};
+    int i = queue->count++;
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!Before(event, queue->heap[parent]))
+            break;
+        queue->heap[i] = queue->heap[parent];
+        i = parent;
+    }
+    queue->heap[i] = event;
+    return true;
+}
+
+ScheduledEvent EventPop(EventQueue *queue)
+{
+    ScheduledEvent first = queue->heap[0];
+    ScheduledEvent last = queue->heap[--queue->count];
+
+    int i = 0;
+    for (;;)
+    {
+        int child = 2 * i + 1;
+        if (child >= queue->count)
+            break;
+        if (child + 1 < queue->count && Before(queue->heap[child + 1], queue->heap[child]))
+            child++;
+        if (!Before(queue->heap[child], last))
+            break;
+        queue->heap[i] = queue->heap[child];
+        i = child;
+    }
+    if (queue->count > 0)
+        queue->heap[i] = last;
+    return first;
+}
+
+static bool Before(ScheduledEvent a, ScheduledEvent b)
+{
+    return a.tick < b.tick || (a.tick == b.tick && a.id < b.id);
+}
@@ -0,0 +1,45 @@
+/*
+ * events.h
+ *
+ * Event queue: a binary min-heap of (tick, id) pairs, the earliest tick
+ * on top and the lower id first within a tick. SimIdle keeps one entry
+ * per projectile in flight, due the tick it next hits a ship or a wall,
+ * and only steps the simulation on those ticks.
+ *
+ * Like the occupancy grid it owns no memory: the caller hands it room
+ * for `capacity` events (SimIdle uses its thread's SimScratch).
+ */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdbool.h>
+
+typedef struct
+{
+    int tick;
+    int id;
+} ScheduledEvent;
+
+typedef struct
+{
+    int capacity;
+    int count;
+    ScheduledEvent *heap; // heap[0] is the earliest
+} EventQueue;
+
+void EventQueueInit(EventQueue *queue, ScheduledEvent *storage, int capacity);
+
+// O(log n). False, and nothing queued, when the queue is full.
+bool EventPush(EventQueue *queue, int tick, int id);
+
+// Remove and return the earliest event; the queue must not be empty
+ScheduledEvent EventPop(EventQueue *queue);
+
+// The earliest event, left queued; the queue must not be empty
+static inline ScheduledEvent EventPeek(const EventQueue *queue)
+{
+    return queue->heap[0];
+}
+
+#endif // EVENTS_H
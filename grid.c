@@ -0,0 +1,165 @@
+/*
+ * grid.c
+ *
+ * Counting-sort occupancy grid (see grid.h).
+ */
+
+#include "grid.h"
+
+#include <string.h>
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static int Buckets(const OccupancyGrid *grid);
+
+// ---------------------------------------------------------------------
+//  GridInit
+//    Carve the caller's storage into the bucket starts, the sorted
+//    entries and the staging area GridAdd fills
+// ---------------------------------------------------------------------
+void GridInit(OccupancyGrid *grid, int *storage, int capacity)
+{
+    memset(grid, 0, sizeof(OccupancyGrid));
+    grid->capacity = capacity;
+    grid->start = storage;
+    grid->x = grid->start + 2 * capacity + 3;
+    grid->y = grid->x + capacity;
+    grid->id = grid->y + capacity;
+    grid->addX = grid->id + capacity;
+    grid->addY = grid->addX + capacity;
+    grid->addId = grid->addY + capacity;
+    grid->addBucket = grid->addId + capacity;
+    grid->columns = 1;
+    grid->rows = 1;
+}
+
+// ---------------------------------------------------------------------
+//  Build
+//    GridBegin picks the coarsest bucket size that keeps at most two
+//    buckets per expected entity, so clearing the counts costs no more
+//    than adding the entities
+// ---------------------------------------------------------------------
+void GridBegin(OccupancyGrid *grid, const GameMap *map, int expected)
+{
+    if (expected > grid->capacity)
+        expected = grid->capacity;
+    long target = (expected > 0) ? 2L * expected : 1;
+
+    // Each step up quarters the bucket count, so start at log4 of how
+    // many times too many single-cell buckets there would be
+    long excess = ((long)map->width * map->height) / target;
+    grid->shift = 0;
+    while ((excess >>= 2) > 0)
+        grid->shift++;
+    for (;;)
+    {
+        grid->columns = ((map->width - 1) >> grid->shift) + 1;
+        grid->rows = ((map->height - 1) >> grid->shift) + 1;
+        if ((long)grid->columns * grid->rows <= target)
+            break;
+        grid->shift++;
+    }
+
+    grid->count = 0;
+    memset(grid->start, 0, sizeof(int) * (size_t)(Buckets(grid) + 2));
+}
+
+void GridAdd(OccupancyGrid *grid, int id, int x, int y)
+{
+    if (grid->count == grid->capacity)
+        return;
+
+    int bucket = (y >> grid->shift) * grid->columns + (x >> grid->shift);
+    int i = grid->count++;
+    grid->addX[i] = x;
+    grid->addY[i] = y;
+    grid->addId[i] = id;
+    grid->addBucket[i] = bucket;
+    grid->start[bucket + 2]++;
+}
+
+void GridFinish(OccupancyGrid *grid)
+{
+    // start[b + 1] = entries before bucket b, then each entry bumps its
+    // bucket's cursor, which leaves start[b + 1] at the end of bucket b
+    int buckets = Buckets(grid);
+    for (int b = 2; b <= buckets + 1; b++)
+        grid->start[b] += grid->start[b - 1];
+
+    for (int i = 0; i < grid->count; i++)
+    {
+        int at = grid->start[grid->addBucket[i] + 1]++;
+        grid->x[at] = grid->addX[i];
+        grid->y[at] = grid->addY[i];
+        grid->id[at] = grid->addId[i];
+    }
+}
+
+static int Buckets(const OccupancyGrid *grid)
+{
+    return grid->columns * grid->rows;
+}
+
+// ---------------------------------------------------------------------
+//  Queries
+// ---------------------------------------------------------------------
+int GridQueryCell(const OccupancyGrid *grid, int x, int y, int *ids, int maxIds)
+{
+    int bx = x >> grid->shift;
+    int by = y >> grid->shift;
+    if (x < 0 || y < 0 || bx >= grid->columns || by >= grid->rows)
+        return 0;
+
+    int bucket = by * grid->columns + bx;
+    int found = 0;
+    for (int i = grid->start[bucket]; i < grid->start[bucket + 1]; i++)
+    {
+        if (grid->x[i] == x && grid->y[i] == y)
+        {
+            if (found < maxIds)
+                ids[found] = grid->id[i];
+            found++;
+        }
+    }
+    return found;
+}
+
+int GridQueryRect(const OccupancyGrid *grid, int x0, int y0, int x1, int y1,
+                  int *ids, int maxIds)
+{
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x0 >= x1 || y0 >= y1)
+        return 0;
+
+    int bx0 = x0 >> grid->shift;
+    int by0 = y0 >> grid->shift;
+    int bx1 = (x1 - 1) >> grid->shift;
+    int by1 = (y1 - 1) >> grid->shift;
+    if (bx1 >= grid->columns)
+        bx1 = grid->columns - 1;
+    if (by1 >= grid->rows)
+        by1 = grid->rows - 1;
+
+    int found = 0;
+    for (int by = by0; by <= by1; by++)
+    {
+        for (int bx = bx0; bx <= bx1; bx++)
+        {
+            int bucket = by * grid->columns + bx;
+            for (int i = grid->start[bucket]; i < grid->start[bucket + 1]; i++)
+            {
+                if (grid->x[i] >= x0 && grid->x[i] < x1 && grid->y[i] >= y0 && grid->y[i] < y1)
+                {
+                    if (found < maxIds)
+                        ids[found] = grid->id[i];
+                    found++;
+                }
+            }
+        }
+    }
+    return found;
+}
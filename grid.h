@@ -0,0 +1,54 @@
+/*
+ * grid.h
+ *
+ * Uniform spatial grid: which entities (ships, projectiles, anything
+ * with a cell) stand where, rebuilt from scratch every tick.
+ *
+ * The map is cut into square buckets of 2^shift cells, with about two
+ * buckets per entity, and the entities are counting-sorted by bucket.
+ * A rebuild is O(entities) however large the map is, and a cell or
+ * rectangle query only looks at the buckets it overlaps. Entities keep
+ * the order they were added in within a cell.
+ *
+ * The grid owns no memory: the caller hands it GRID_STORAGE_INTS(n)
+ * ints (on the stack for small n), so it can be rebuilt every tick
+ * without allocating and never outlives its user.
+ */
+
+#ifndef GRID_H
+#define GRID_H
+
+#include "simulation.h"
+
+// Ints of storage for a grid of up to `capacity` entities
+#define GRID_STORAGE_INTS(capacity) (9 * (capacity) + 3)
+
+typedef struct
+{
+    int capacity;
+    int count;          // Entities added since GridBegin
+    int shift;          // Bucket side is 1 << shift cells
+    int columns, rows;  // Buckets per map row / column
+    int *start;         // Bucket b holds sorted entries [start[b], start[b + 1])
+    int *x, *y, *id;    // Sorted entries
+    int *addX, *addY, *addId, *addBucket; // Entries in the order added
+} OccupancyGrid;
+
+void GridInit(OccupancyGrid *grid, int *storage, int capacity);
+
+// Rebuild for up to `expected` entities (at most the capacity) on `map`:
+// GridBegin, then GridAdd each entity, then GridFinish before querying
+void GridBegin(OccupancyGrid *grid, const GameMap *map, int expected);
+void GridAdd(OccupancyGrid *grid, int id, int x, int y);
+void GridFinish(OccupancyGrid *grid);
+
+// Ids of the entities on cell (x, y), in the order they were added.
+// Writes at most maxIds of them, returns how many there are.
+int GridQueryCell(const OccupancyGrid *grid, int x, int y, int *ids, int maxIds);
+
+// Ids of the entities in cells [x0, x1) x [y0, y1), bucket by bucket.
+// Writes at most maxIds of them, returns how many there are.
+int GridQueryRect(const OccupancyGrid *grid, int x0, int y0, int x1, int y1,
+                  int *ids, int maxIds);
+
+#endif // GRID_H
@@ -10,515 +10,1673 @@
  *    - Player2 (labelled 'B' on map):
  *        Movement with arrow keys
  *        Fire with Right Shift
+ *    - Player3 and up ('C', 'D', ...) are bots with random input
+ *    - --ai N hands player N to the computer player (bot.h), which
+ *      searches for its moves every tick: --ai 2 to play alone
+ *    - Camera:
+ *        Zoom with the mouse wheel, pan by dragging with the right
+ *        mouse button, Home to reset the view
+ *
+ * The game rules live in simulation.c (no raylib); this file only
+ * polls the keyboard and draws.
  *
  * Compile on terminal (Mac):
- *    gcc monomaxia.c -o monomaxia -lraylib
+ *    gcc -pthread monomaxia.c simulation.c projectiles.c grid.c events.c replay.c snapshot.c \
+ *        net.c netclient.c prediction.c bot.c -o monomaxia -lraylib -lm
+ *
+ * Headless simulator (no raylib needed), see monomaxia_headless.c:
+ *    gcc -O2 -pthread monomaxia_headless.c simulation.c projectiles.c grid.c events.c replay.c \
+ *        snapshot.c bot.c -o monomaxia_headless -lm
  *
  * Then run:
- *    ./monomaxia.exe
+ *    ./monomaxia.exe [tickRate] [--map WxH] [--players N] [--record match.mmxr]
+ *                    [--ai N ...] [--ai-budget ms]
+ *                    [--dirty] [--bench-draw frames [--draw-immediate]]
+ *    ./monomaxia.exe --connect host [--port 27960]
+ *
+ * --map sets the bay size in cells (default 20x10, up to 4096x4096).
+ * Maps larger than the window are explored with the camera; only the
+ * visible cells are drawn, so a big map costs no more per frame than
+ * a small one.
+ *
+ * --players sets the number of ships (default 2, up to MAX_PLAYERS of
+ * the build, see simulation.h).
+ *
+ * The simulation runs at a fixed tickRate (default 60 ticks/sec, e.g.
+ * 30 or 120) no matter how fast frames are drawn; rendering is vsynced
+ * and interpolates between the last two simulation states.
+ *
+ * --dirty is for low-power kiosks: the picture is kept between frames
+ * and only the cells whose contents changed are repainted. Ships and
+ * projectiles then step from cell to cell instead of gliding, and a
+ * frame without a tick repaints nothing.
+ *
+ * --ai can be given for several players; each computer player searches
+ * for --ai-budget milliseconds a tick (default 2, at most 1000) on every
+ * core.
+ *
+ * --record writes every tick's input to a replay log that
+ * monomaxia_headless --replay re-simulates and verifies.
+ *
+ * --connect joins a match on a monomaxia_server instead of playing
+ * locally; the map, player count and tick rate come from the server.
+ * Either key layout steers your ship. Your moves show at once: the
+ * client predicts every tick and rolls back when the server's state
+ * disagrees (prediction.h), so controls do not wait a round trip.
+ *
+ * --bench-draw plays `frames` frames of random input without vsync, one
+ * tick per frame, and prints the average DrawGame and whole-frame time
+ * (the simulation phases are benchmarked by monomaxia_bench.c). Add
+ * --draw-immediate to time the one-raylib-call-per-sprite path against
+ * the batched one, or --dirty to time the kiosk renderer. About 10k
+ * sprites (ships with their label and HP, and projectiles) on screen:
+ *    gcc -O2 -pthread -DMAX_PLAYERS=4000 monomaxia.c simulation.c projectiles.c grid.c \
+ *        events.c replay.c snapshot.c net.c netclient.c prediction.c bot.c -o monomaxia_big \
+ *        -lraylib -lm
+ *    ./monomaxia_big --bench-draw 600 --players 4000 --map 160x80
  */
 
 #include <raylib.h>
+#include <rlgl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <math.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "bot.h"
+#include "grid.h"
+#include "net.h"
+#include "netclient.h"
+#include "prediction.h"
+#include "replay.h"
+#include "simulation.h"
 
 // ---------------------------------------------------------------------
 //  Constants
 // ---------------------------------------------------------------------
-#define SCREEN_SCALE 64 // Each cell is 64×64 pixels
-#define MAP_WIDTH 20
-#define MAP_HEIGHT 10
+#define SCREEN_SCALE 64 // Each cell is 64×64 pixels at zoom 1
+
+// Largest window; a smaller map shrinks it to fit
+#define MAX_WINDOW_WIDTH (DEFAULT_MAP_WIDTH * SCREEN_SCALE)
+#define MAX_WINDOW_HEIGHT (DEFAULT_MAP_HEIGHT * SCREEN_SCALE)
 
-#define MAX_PLAYERS 2
-#define MAX_PROJECTILES 5
-#define MAX_SPEED 1 // Movement speed (in cells) per frame
+// Camera zoom limits. MIN_ZOOM bounds how many cells can be on screen
+// (and so drawn) at once, however large the map.
+#define MIN_ZOOM 0.125f
+#define MAX_ZOOM 4.0f
+#define ZOOM_STEP 1.25f // Per mouse wheel notch
 
 // For drawing a net:
 #define NET_LINE_SPACING 32 // in pixels
 
+#define SPRITE_SIZE (SCREEN_SCALE / 2) // Ships and projectiles, in pixels
+#define LABEL_LETTERS 26               // Ships are labelled 'A' .. 'Z'
+#define ATLAS_WIDTH 512
+#define ATLAS_HEIGHT 256
+#define ATLAS_CELL (SPRITE_SIZE + 2)   // 1 pixel gutter against bleeding
+#define ATLAS_COLUMNS (ATLAS_WIDTH / ATLAS_CELL)
+#define SPRITE_CHUNK 512               // Quads per rlgl batch check
+#define HUD_ENTRIES 64                 // Cached HUD strings
+
+// Cells on screen at MIN_ZOOM (8 = 1 / MIN_ZOOM), plus partial ones
+#define DIRTY_MAP_CELLS ((MAX_WINDOW_WIDTH * 8 / SCREEN_SCALE + 2) * \
+                         (MAX_WINDOW_HEIGHT * 8 / SCREEN_SCALE + 2))
+// Past this share of the visible cells a full repaint is cheaper
+#define DIRTY_MAX_SHARE 4 // 1/4
+
+// Ship and projectile colors, by player (repeating past the end)
+static const Color playerColors[] = {RED, GREEN, ORANGE, PURPLE, YELLOW, PINK, MAROON, LIME};
+#define PLAYER_COLORS ((int)(sizeof(playerColors) / sizeof(playerColors[0])))
+
+// Fixed simulation step
+#define DEFAULT_TICK_RATE 60 // ticks per second
+#define MAX_TICK_RATE 65535  // Replay logs keep it in 16 bits
+
+// --ai-budget range in ms: the search runs in the render loop, so a
+// tick may wait for it at most a second
+#define MIN_BOT_BUDGET_MS 0.01
+#define MAX_BOT_BUDGET_MS 1000.0
+#define MAX_FRAME_TIME 0.25  // seconds; longer stalls are dropped, not replayed
+#define CONNECT_TIMEOUT 5.0  // seconds to get a seat from the server
+#define HELLO_INTERVAL 0.25  // seconds between hellos until one is answered
+
+#define BENCH_MATCH_TICKS 30 // --bench-draw restarts the match this often
+
 // ---------------------------------------------------------------------
 //  Structs
 // ---------------------------------------------------------------------
 
+// Map cells [x0, x1) x [y0, y1)
 typedef struct
 {
-    int x, y;    // Position in map cells
-    int dx, dy;  // Movement direction
-    bool active; // Whether projectile is still moving
-} Projectile;
+    int x0, y0, x1, y1;
+} CellRect;
 
+// Keys of one human player
 typedef struct
 {
-    int x, y; // Position (map cells)
-    int hp;   // “Health” points
-    // Movement each frame (set by input)
-    int vx, vy;
-    // Array of projectiles
-    Projectile projectiles[MAX_PROJECTILES];
-} Ship;
+    int up, down, left, right, fire;
+} KeyLayout;
+
+// Water, net and obstacles never change during a match, so they are
+// drawn once into a texture and blitted each frame. The texture holds
+// the cells around the view at the camera's zoom, and is redrawn when
+// the view leaves them, the zoom changes or the map is a different one.
+typedef struct
+{
+    RenderTexture2D target;
+    bool valid;
+    const GameMap *map;
+    float zoom;
+    CellRect cells;
+} BackgroundCache;
+
+static BackgroundCache background;
+
+// Sprites in the atlas; HUD strings follow from SPRITE_COUNT on
+enum
+{
+    SPRITE_PROJECTILE, // White disc, tinted with the owner's color
+    SPRITE_HULL,       // White square, tinted with the owner's color
+    SPRITE_LABEL,      // First of the LABEL_LETTERS white letters
+    SPRITE_COUNT = SPRITE_LABEL + LABEL_LETTERS
+};
+
+// What a cached HUD string shows; the value says which one
+typedef enum
+{
+    HUD_HP,     // value = HP
+    HUD_WINNER  // value = MatchWinner
+} HudKind;
 
 typedef struct
 {
-    char name[50];
-    Ship ship;
-} Player;
+    int fontSize;
+    Color color;
+} HudStyle;
 
 typedef struct
 {
-    Player players[MAX_PLAYERS];
-    bool gameOver;
-    char map[MAP_HEIGHT][MAP_WIDTH];
-} GameState;
+    HudKind kind;
+    int value;
+} HudKey;
+
+// Every ship, label and projectile sprite in one small texture, so
+// they all share a texture bind and draw call (see DrawSprites). The
+// rows below the fixed sprites hold HUD strings, rendered on first use
+// into the CPU copy of the atlas and uploaded again.
+typedef struct
+{
+    Texture2D texture;
+    Image image;
+    bool valid;
+    Rectangle source[SPRITE_COUNT + HUD_ENTRIES];
+
+    HudKey textKeys[HUD_ENTRIES];
+    int textCount;
+    int textTop;                   // First pixel row for HUD strings
+    int shelfX, shelfY, shelfHeight; // Packing cursor
+    bool textFull;                 // Cleared at the start of the next frame
+    int generation;                // Bumped when HUD strings move
+} SpriteAtlas;
+
+// One quad, as large as its sprite: top-left corner in world pixels,
+// sprite, tint
+typedef struct
+{
+    float x, y;
+    int sprite;
+    Color tint;
+} SpriteInstance;
+
+static const HudStyle hudStyles[] = {
+    [HUD_HP] = {14, BLACK},
+    [HUD_WINNER] = {30, RED},
+};
+
+static SpriteAtlas atlas;
+
+// Names for the winner text, the same for every match
+static Roster roster;
+
+// Filled by DrawGame every frame: a projectile, or a hull, label and
+// HP per entity, in drawing order
+#define SPRITE_LIST_CAPACITY (PROJECTILE_CAPACITY + 3 * MAX_PLAYERS)
+static SpriteInstance sprites[SPRITE_LIST_CAPACITY];
+static SpriteInstance hpSprites[MAX_PLAYERS];
+
+// Kiosk mode (--dirty): the scene stays in `target` between frames, and
+// only the cells whose sprites differ from what it shows are repainted
+typedef struct
+{
+    RenderTexture2D target;
+    bool valid;
+    Camera2D camera;     // View it was painted with
+    const GameMap *map;
+    int generation;      // atlas.generation it was painted with
+
+    SpriteInstance painted[SPRITE_LIST_CAPACITY]; // What it shows
+    int paintedCount;
+    bool matched[SPRITE_LIST_CAPACITY];
+    int lookup[2 * SPRITE_LIST_CAPACITY]; // painted index + 1, 0 = empty
+
+    CellRect visible;                    // Cells dirty[] covers
+    unsigned char dirty[DIRTY_MAP_CELLS];
+    int dirtyCells[DIRTY_MAP_CELLS];     // Which are set, as indices
+    int dirtyCount;
+} DirtyCanvas;
+
+static DirtyCanvas canvas;
+static bool drawDirty = false; // --dirty
+
+// Set by --draw-immediate to benchmark the unbatched path
+static bool drawImmediate = false;
+
+// Ships and projectiles by cell, rebuilt every frame so DrawGame only
+// visits what the camera can see. One window, so the storage is static.
+#define ENTITY_CAPACITY (MAX_PLAYERS + PROJECTILE_CAPACITY)
+static int entityGridStorage[GRID_STORAGE_INTS(ENTITY_CAPACITY)];
+static OccupancyGrid entityGrid;
+static int visibleIds[ENTITY_CAPACITY];
+
+// Players beyond these are bots
+static const KeyLayout keyLayouts[] = {
+    {KEY_W, KEY_S, KEY_A, KEY_D, KEY_LEFT_SHIFT},              // Player1
+    {KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT, KEY_RIGHT_SHIFT}, // Player2
+};
+#define HUMAN_PLAYERS ((int)(sizeof(keyLayouts) / sizeof(keyLayouts[0])))
 
 // ---------------------------------------------------------------------
 //  Forward Declarations
 // ---------------------------------------------------------------------
-void InitGame(GameState *game);
-void DrawGame(const GameState *game);
-void UpdateGame(GameState *game);
+int DrawGame(const GameState *previous, const GameState *game, float alpha,
+             const Camera2D *camera);
 
 // Helper subroutines
-static void InitMap(GameState *game);
-static void InitShip(Ship *ship, int startX, int startY);
-static void InitProjectile(Projectile *p);
-
-static void HandleInput(GameState *game);
-static void UpdateShips(GameState *game);
-static void UpdateProjectiles(GameState *game);
-static void CheckHits(GameState *game);
+static void HandleInput(InputFrame *input);
+static void BotInput(unsigned int *seed, InputFrame *input, int playerCount);
+static void HandleCamera(Camera2D *camera, const GameMap *map);
+static void ResetCamera(Camera2D *camera, const GameMap *map);
+static void ClampCamera(Camera2D *camera, const GameMap *map);
+static CellRect VisibleCells(const Camera2D *camera, const GameMap *map);
+static CellRect ClampCells(CellRect cells, const GameMap *map);
+static int CollectVisible(const GameState *game, CellRect visible);
+static int CollectSprites(const GameState *previous, const GameState *game, float alpha,
+                          CellRect visible);
 
 // New helper for drawing the “bay” background & net
-static void DrawBayBackground(int screenWidth, int screenHeight);
+static void DrawBayBackground(CellRect cells);
+static void DrawObstacles(const GameMap *map, CellRect cells);
+static void PrepareStaticLayer(const GameMap *map, const Camera2D *camera, CellRect visible);
+static void DrawStaticLayer(void);
+static void UnloadStaticLayer(void);
+static void PrepareAtlas(void);
+static void UnloadAtlas(void);
+static void DrawSprites(const SpriteInstance *list, int count);
+static void DrawSpritesImmediate(const SpriteInstance *list, int count);
+static int HudText(HudKind kind, int value);
+static void FormatHud(HudKind kind, int value, char *text, size_t size);
+static void ClearHudText(void);
+static void DrawHudText(HudKind kind, int value, int x, int y);
+int DrawGameDirty(const GameState *game, const Camera2D *camera);
+static bool MarkChanges(int count);
+static bool MarkSprite(const SpriteInstance *sprite, int limit);
+static CellRect SpriteCells(const SpriteInstance *sprite);
+static bool SpriteTouchesDirty(const SpriteInstance *sprite);
+static unsigned int SpriteHash(const SpriteInstance *sprite);
+static bool SameSprite(const SpriteInstance *a, const SpriteInstance *b);
+static void DrawStaticCell(int x, int y);
+static void UnloadCanvas(void);
+
+static bool ParseInt(const char *text, int *value);
+static bool ParseDouble(const char *text, double *value);
+static bool ParseMapSize(const char *text, int *width, int *height);
+static int BadValue(const char *option, const char *text, double min, double max);
+
+static int BenchDraw(const GameMap *map, int players, int screenWidth, int screenHeight,
+                     int frames);
+static int PlayOnline(const char *host, int port);
+static bool Connect(NetSocket *sock, const struct sockaddr_in *server, NetClient *client);
+static void ReceiveStates(NetSocket *sock, NetClient *client, Predictor *predictor);
 
 // ---------------------------------------------------------------------
 //  Main Entry
 // ---------------------------------------------------------------------
-int main(void)
+int main(int argc, char **argv)
 {
-    const int screenWidth = MAP_WIDTH * SCREEN_SCALE;
-    const int screenHeight = MAP_HEIGHT * SCREEN_SCALE;
+    int tickRate = DEFAULT_TICK_RATE;
+    int mapWidth = DEFAULT_MAP_WIDTH;
+    int mapHeight = DEFAULT_MAP_HEIGHT;
+    int players = DEFAULT_PLAYERS;
+    const char *recordPath = NULL;
+    const char *connectHost = NULL;
+    int port = NET_DEFAULT_PORT;
+    int benchFrames = 0;
+    bool aiPlayers[MAX_PLAYERS] = {false};
+    double aiBudget = DEFAULT_BOT_BUDGET;
+    InitRoster(&roster, MAX_PLAYERS);
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "--record") == 0 && a + 1 < argc)
+            recordPath = argv[++a];
+        else if (strcmp(argv[a], "--bench-draw") == 0 && a + 1 < argc)
+        {
+            if (!ParseInt(argv[++a], &benchFrames) || benchFrames < 1)
+                return BadValue(argv[a - 1], argv[a], 1, INT_MAX);
+        }
+        else if (strcmp(argv[a], "--map") == 0 && a + 1 < argc)
+        {
+            if (!ParseMapSize(argv[++a], &mapWidth, &mapHeight))
+            {
+                fprintf(stderr, "Map must be %d..%d cells a side\n", MIN_MAP_SIZE, MAX_MAP_SIZE);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[a], "--players") == 0 && a + 1 < argc)
+        {
+            if (!ParseInt(argv[++a], &players) || players < 2 || players > MAX_PLAYERS)
+                return BadValue(argv[a - 1], argv[a], 2, MAX_PLAYERS);
+        }
+        else if (strcmp(argv[a], "--draw-immediate") == 0)
+            drawImmediate = true;
+        else if (strcmp(argv[a], "--dirty") == 0)
+            drawDirty = true;
+        else if (strcmp(argv[a], "--connect") == 0 && a + 1 < argc)
+            connectHost = argv[++a];
+        else if (strcmp(argv[a], "--port") == 0 && a + 1 < argc)
+        {
+            if (!ParseInt(argv[++a], &port) || port < 1 || port > 65535)
+                return BadValue(argv[a - 1], argv[a], 1, 65535);
+        }
+        else if (strcmp(argv[a], "--ai") == 0 && a + 1 < argc)
+        {
+            int player;
+            if (!ParseInt(argv[++a], &player) || player < 1 || player > MAX_PLAYERS)
+                return BadValue(argv[a - 1], argv[a], 1, MAX_PLAYERS);
+            aiPlayers[player - 1] = true;
+        }
+        else if (strcmp(argv[a], "--ai-budget") == 0 && a + 1 < argc)
+        {
+            double ms;
+            if (!ParseDouble(argv[++a], &ms) || !(ms >= MIN_BOT_BUDGET_MS && ms <= MAX_BOT_BUDGET_MS))
+                return BadValue(argv[a - 1], argv[a], MIN_BOT_BUDGET_MS, MAX_BOT_BUDGET_MS);
+            aiBudget = ms / 1000.0;
+        }
+        else
+        {
+            // The one positional argument: the tick rate
+            if (!ParseInt(argv[a], &tickRate))
+            {
+                fprintf(stderr, "unknown argument: %s\n", argv[a]);
+                return 1;
+            }
+            if (tickRate < 1 || tickRate > MAX_TICK_RATE)
+                return BadValue("tickRate", argv[a], 1, MAX_TICK_RATE);
+        }
+    }
+    if (connectHost != NULL)
+        return PlayOnline(connectHost, port);
 
-    InitWindow(screenWidth, screenHeight, "Monomaxia on a Bay");
-    SetTargetFPS(60);
+    // --players may come after --ai
+    for (int i = players; i < MAX_PLAYERS; i++)
+    {
+        if (aiPlayers[i])
+        {
+            fprintf(stderr, "--ai %d: the match has only %d players\n", i + 1, players);
+            return 1;
+        }
+    }
+
+    GameMap *map = MapCreate(mapWidth, mapHeight);
+    if (map == NULL)
+    {
+        fprintf(stderr, "Map must be %d..%d cells a side\n", MIN_MAP_SIZE, MAX_MAP_SIZE);
+        return 1;
+    }
+
+    // The window shows the whole map when it fits, else a camera view
+    int screenWidth = mapWidth * SCREEN_SCALE;
+    int screenHeight = mapHeight * SCREEN_SCALE;
+    if (screenWidth > MAX_WINDOW_WIDTH)
+        screenWidth = MAX_WINDOW_WIDTH;
+    if (screenHeight > MAX_WINDOW_HEIGHT)
+        screenHeight = MAX_WINDOW_HEIGHT;
+
+    if (benchFrames > 0)
+    {
+        int result = BenchDraw(map, players, screenWidth, screenHeight, benchFrames);
+        MapFree(map);
+        return result;
+    }
 
     GameState game;
-    InitGame(&game);
+    InitGame(&game, map, players);
+    GameState previous = game; // State one tick ago, for interpolation
 
-    while (!WindowShouldClose())
+    // Computer players, each with its own search threads
+    Bot *bots[MAX_PLAYERS] = {NULL};
+    for (int i = 0; i < game.playerCount; i++)
     {
-        if (!game.gameOver)
+        if (!aiPlayers[i])
+            continue;
+        BotConfig config;
+        BotDefaultConfig(&config, i);
+        config.budget = aiBudget;
+        config.seed = (unsigned int)i + 1;
+        bots[i] = BotCreate(&config);
+        if (bots[i] == NULL)
         {
-            // 1) Handle keyboard input -> movement & firing
-            HandleInput(&game);
+            fprintf(stderr, "Cannot start the computer player for %s\n", roster.names[i]);
+            for (int j = 0; j < i; j++)
+                BotDestroy(bots[j]);
+            MapFree(map);
+            return 1;
+        }
+    }
 
-            // 2) Update ships
-            UpdateShips(&game);
+    ReplayWriter recorder = {0};
+    if (recordPath != NULL && !ReplayWriterOpen(&recorder, recordPath, tickRate, &game))
+    {
+        fprintf(stderr, "Cannot record to %s\n", recordPath);
+        for (int i = 0; i < game.playerCount; i++)
+            BotDestroy(bots[i]);
+        MapFree(map);
+        return 1;
+    }
+    const double tickTime = 1.0 / tickRate;
 
-            // 3) Update projectiles
-            UpdateProjectiles(&game);
+    // Frame rate follows the display, the game speed follows tickRate
+    SetConfigFlags(FLAG_VSYNC_HINT);
+    InitWindow(screenWidth, screenHeight, "Monomaxia on a Bay");
 
-            // 4) Check hits
-            CheckHits(&game);
-        }
+    Camera2D camera;
+    ResetCamera(&camera, map);
 
-        // 5) Drawing
-        BeginDrawing();
-        ClearBackground(RAYWHITE);
+    double accumulator = 0.0;
+    unsigned char pendingFire[MAX_PLAYERS] = {0}; // Presses not yet ticked
+    unsigned int botSeed = 1;
+
+    while (!WindowShouldClose())
+    {
+        // 1) Handle keyboard input -> input frame. A fire press is
+        //    latched until a tick consumes it, so it is neither lost
+        //    on a frame without ticks nor repeated on a catch-up frame.
+        InputFrame input;
+        HandleInput(&input);
+        for (int i = 0; i < HUMAN_PLAYERS; i++)
+            pendingFire[i] |= input.keys[i] & INPUT_FIRE;
+        HandleCamera(&camera, map);
 
-        // Draw the entire scene
-        DrawGame(&game);
+        // 2) Advance the simulation by as many fixed ticks as the
+        //    elapsed time covers
+        accumulator += GetFrameTime();
+        if (accumulator > MAX_FRAME_TIME)
+            accumulator = MAX_FRAME_TIME;
 
-        // If game is over, show a message
-        if (game.gameOver)
+        while (accumulator >= tickTime)
         {
-            // Identify winner or tie
-            int hpA = game.players[0].ship.hp;
-            int hpB = game.players[1].ship.hp;
-            if (hpA <= 0 && hpB <= 0)
+            CopyGameState(&previous, &game);
+            if (!game.gameOver)
             {
-                DrawText("TIE! Nobody survived!", 40, 10, 30, RED);
-            }
-            else
-            {
-                int winnerIndex = (hpB > hpA) ? 1 : 0;
-                char winnerMsg[100];
-                snprintf(winnerMsg, sizeof(winnerMsg),
-                         "GAME OVER! Winner: %s", game.players[winnerIndex].name);
-                DrawText(winnerMsg, 40, 10, 30, RED);
+                for (int i = 0; i < HUMAN_PLAYERS; i++)
+                {
+                    input.keys[i] = (unsigned char)((input.keys[i] & ~INPUT_FIRE) | pendingFire[i]);
+                    pendingFire[i] = 0;
+                }
+                BotInput(&botSeed, &input, game.playerCount);
+                for (int i = 0; i < game.playerCount; i++)
+                {
+                    if (bots[i] != NULL)
+                        input.keys[i] = BotThink(bots[i], &game);
+                }
+                SimStep(&game, &input);
+                if (recorder.file != NULL)
+                    ReplayWriterTick(&recorder, &input, &game);
             }
+            accumulator -= tickTime;
         }
+
+        // How far real time is between `previous` and `game`
+        float alpha = (float)(accumulator / tickTime);
+
+        // 3) Drawing
+        BeginDrawing();
+        ClearBackground(RAYWHITE);
+
+        // Draw the entire scene (the part the camera sees), or in kiosk
+        // mode just what changed
+        if (drawDirty)
+            DrawGameDirty(&game, &camera);
+        else
+            DrawGame(&previous, &game, alpha, &camera);
+
+        // If game is over, show the winner (or the tie)
+        if (game.gameOver)
+            DrawHudText(HUD_WINNER, MatchWinner(&game), 40, 10);
         EndDrawing();
     }
 
+    if (recorder.file != NULL)
+        ReplayWriterClose(&recorder);
+    for (int i = 0; i < game.playerCount; i++)
+        BotDestroy(bots[i]);
+
+    UnloadStaticLayer();
+    UnloadAtlas();
+    UnloadCanvas();
+
     CloseWindow();
+    MapFree(map);
     return 0;
 }
 
 // ---------------------------------------------------------------------
-//  InitGame
+//  Command line
+//    Numbers must be the whole argument, so a typo fails loudly
+//    instead of leaving the default in place
 // ---------------------------------------------------------------------
-void InitGame(GameState *game)
+static bool ParseInt(const char *text, int *value)
 {
-    memset(game, 0, sizeof(GameState));
-    InitMap(game);
+    char *end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || number < INT_MIN || number > INT_MAX)
+        return false;
+    *value = (int)number;
+    return true;
+}
 
-    // Player names
-    strcpy(game->players[0].name, "Player1");
-    strcpy(game->players[1].name, "Player2");
+static bool ParseDouble(const char *text, double *value)
+{
+    char *end;
+    errno = 0;
+    double number = strtod(text, &end);
+    if (end == text || *end != '\0' || errno != 0)
+        return false;
+    *value = number;
+    return true;
+}
 
-    // Initialize ships in the corners
-    InitShip(&game->players[0].ship, 2, 2);
-    InitShip(&game->players[1].ship, MAP_WIDTH - 2, MAP_HEIGHT - 2);
+// "WxH", e.g. 160x80
+static bool ParseMapSize(const char *text, int *width, int *height)
+{
+    int w, h, used = 0;
+    if (sscanf(text, "%dx%d%n", &w, &h, &used) != 2 || text[used] != '\0')
+        return false;
+    *width = w;
+    *height = h;
+    return true;
+}
 
-    game->gameOver = false;
+// Numbers out of range are refused too, not clamped behind the user's back
+static int BadValue(const char *option, const char *text, double min, double max)
+{
+    fprintf(stderr, "%s needs a number from %.10g to %.10g, not \"%s\"\n", option, min, max, text);
+    return 1;
 }
 
 // ---------------------------------------------------------------------
-//  Map / Ship / Projectile
+//  Drawing the “Bay”
+//    In world pixels (cell * SCREEN_SCALE), limited to `cells`
 // ---------------------------------------------------------------------
-static void InitMap(GameState *game)
+static void DrawBayBackground(CellRect cells)
+{
+    int left = cells.x0 * SCREEN_SCALE;
+    int top = cells.y0 * SCREEN_SCALE;
+    int right = cells.x1 * SCREEN_SCALE;
+    int bottom = cells.y1 * SCREEN_SCALE;
+
+    // Draw a large brown border (the “land”) by drawing a rectangle
+    // and then a slightly smaller “water” rectangle on top of it.
+    DrawRectangle(left, top, right - left, bottom - top, BROWN);
+
+    // Fill an inner rectangle with “water” color
+    DrawRectangle(left, top, right - left, bottom - top, BLUE);
+
+    // Draw net lines on top of the water (cell edges are multiples of
+    // the spacing, so the net lines up across redraws)
+    for (int x = left; x < right; x += NET_LINE_SPACING)
+    {
+        DrawLine(x, top, x, bottom, Fade(LIGHTGRAY, 0.5f));
+    }
+    for (int y = top; y < bottom; y += NET_LINE_SPACING)
+    {
+        DrawLine(left, y, right, y, Fade(LIGHTGRAY, 0.5f));
+    }
+}
+
+static void DrawObstacles(const GameMap *map, CellRect cells)
 {
-    for (int r = 0; r < MAP_HEIGHT; r++)
+    for (int r = cells.y0; r < cells.y1; r++)
     {
-        for (int c = 0; c < MAP_WIDTH; c++)
+        for (int c = cells.x0; c < cells.x1; c++)
         {
-            if (r == 0 || r == MAP_HEIGHT - 1 || c == 0 || c == MAP_WIDTH - 1)
-                game->map[r][c] = '#'; // boundary
-            else
-                game->map[r][c] = '.';
+            char cell = MapCell(map, c, r);
+            if (cell == '#' || cell == 'X')
+            {
+                // Represent obstacles or boundary (X or #) as gray squares
+                DrawRectangle(c * SCREEN_SCALE, r * SCREEN_SCALE,
+                              SCREEN_SCALE, SCREEN_SCALE, DARKGRAY);
+            }
         }
     }
-    // Some obstacles
-    game->map[3][5] = 'X';
-    game->map[5][8] = 'X';
-    game->map[6][10] = 'X';
 }
 
-static void InitShip(Ship *ship, int startX, int startY)
+// ---------------------------------------------------------------------
+//  Static layer cache
+//    PrepareStaticLayer re-renders background + obstacles only when
+//    the visible cells are not all in the texture; DrawStaticLayer
+//    blits it (one draw call) inside the camera transform
+// ---------------------------------------------------------------------
+static void PrepareStaticLayer(const GameMap *map, const Camera2D *camera, CellRect visible)
 {
-    ship->x = startX;
-    ship->y = startY;
-    ship->hp = 3;
-    ship->vx = 0;
-    ship->vy = 0;
+    if (background.valid && background.map == map && background.zoom == camera->zoom &&
+        visible.x0 >= background.cells.x0 && visible.y0 >= background.cells.y0 &&
+        visible.x1 <= background.cells.x1 && visible.y1 <= background.cells.y1)
+        return;
+
+    // Half a view of margin on every side, so panning redraws the
+    // layer every half screen instead of every frame
+    int marginX = (visible.x1 - visible.x0) / 2 + 1;
+    int marginY = (visible.y1 - visible.y0) / 2 + 1;
+    CellRect cells = ClampCells((CellRect){visible.x0 - marginX, visible.y0 - marginY,
+                                           visible.x1 + marginX, visible.y1 + marginY},
+                                map);
+
+    // Texture pixels match screen pixels at the current zoom
+    int width = (int)ceilf((float)((cells.x1 - cells.x0) * SCREEN_SCALE) * camera->zoom);
+    int height = (int)ceilf((float)((cells.y1 - cells.y0) * SCREEN_SCALE) * camera->zoom);
+    if (background.valid && (background.target.texture.width != width ||
+                             background.target.texture.height != height))
+        UnloadStaticLayer();
 
-    for (int i = 0; i < MAX_PROJECTILES; i++)
+    if (!background.valid)
     {
-        InitProjectile(&ship->projectiles[i]);
+        background.target = LoadRenderTexture(width, height);
     }
+
+    Camera2D view = {0};
+    view.target = (Vector2){(float)(cells.x0 * SCREEN_SCALE), (float)(cells.y0 * SCREEN_SCALE)};
+    view.zoom = camera->zoom;
+
+    BeginTextureMode(background.target);
+    ClearBackground(RAYWHITE);
+    BeginMode2D(view);
+    DrawBayBackground(cells);
+    DrawObstacles(map, cells);
+    EndMode2D();
+    EndTextureMode();
+
+    background.valid = true;
+    background.map = map;
+    background.zoom = camera->zoom;
+    background.cells = cells;
 }
 
-static void InitProjectile(Projectile *p)
+static void DrawStaticLayer(void)
 {
-    p->x = -1;
-    p->y = -1;
-    p->dx = 0;
-    p->dy = 0;
-    p->active = false;
+    const Texture2D *texture = &background.target.texture;
+    CellRect cells = background.cells;
+
+    // Render textures are stored bottom-up, hence the negative height
+    DrawTexturePro(*texture,
+                   (Rectangle){0, 0, (float)texture->width, (float)-texture->height},
+                   (Rectangle){(float)(cells.x0 * SCREEN_SCALE), (float)(cells.y0 * SCREEN_SCALE),
+                               (float)((cells.x1 - cells.x0) * SCREEN_SCALE),
+                               (float)((cells.y1 - cells.y0) * SCREEN_SCALE)},
+                   (Vector2){0, 0}, 0.0f, WHITE);
+}
+
+static void UnloadStaticLayer(void)
+{
+    if (background.valid)
+    {
+        UnloadRenderTexture(background.target);
+        background.valid = false;
+    }
 }
 
 // ---------------------------------------------------------------------
-//  Drawing the “Bay”
+//  Sprite batch
+//    The atlas is drawn once with raylib's image functions. DrawSprites
+//    then feeds every quad to rlgl under the one atlas texture, so
+//    rlgl merges them into a single draw call; drawing shapes and text
+//    directly switches texture (and flushes) twice per ship.
 // ---------------------------------------------------------------------
-static void DrawBayBackground(int screenWidth, int screenHeight)
+static void PrepareAtlas(void)
 {
-    // Draw a large brown border (the “land”) by drawing a rectangle
-    // and then a slightly smaller “water” rectangle on top of it.
-    DrawRectangle(0, 0, screenWidth, screenHeight, BROWN);
+    if (atlas.valid)
+    {
+        if (atlas.textFull)
+            ClearHudText();
+        return;
+    }
 
-    // Fill an inner rectangle with “water” color
-    DrawRectangle(0, 0, screenWidth, screenHeight, BLUE);
+    Image image = GenImageColor(ATLAS_WIDTH, ATLAS_HEIGHT, BLANK);
+    for (int s = 0; s < SPRITE_COUNT; s++)
+    {
+        int x = (s % ATLAS_COLUMNS) * ATLAS_CELL + 1;
+        int y = (s / ATLAS_COLUMNS) * ATLAS_CELL + 1;
+        atlas.source[s] = (Rectangle){(float)x, (float)y, SPRITE_SIZE, SPRITE_SIZE};
+
+        if (s == SPRITE_PROJECTILE)
+        {
+            ImageDrawCircle(&image, x + SPRITE_SIZE / 2, y + SPRITE_SIZE / 2,
+                            SPRITE_SIZE / 2, WHITE);
+        }
+        else if (s == SPRITE_HULL)
+        {
+            ImageDrawRectangle(&image, x, y, SPRITE_SIZE, SPRITE_SIZE, WHITE);
+        }
+        else
+        {
+            // Where the label sits on its hull, at half the hull's size
+            char letter[2] = {(char)('A' + s - SPRITE_LABEL), '\0'};
+            ImageDrawText(&image, letter, x + SPRITE_SIZE / 4, y + SPRITE_SIZE / 4,
+                          SPRITE_SIZE / 2, WHITE);
+        }
+    }
+
+    atlas.image = image;
+    atlas.texture = LoadTextureFromImage(image);
+    atlas.textTop = ((SPRITE_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS) * ATLAS_CELL;
+    atlas.valid = true;
+    ClearHudText();
+}
+
+static void UnloadAtlas(void)
+{
+    if (atlas.valid)
+    {
+        UnloadTexture(atlas.texture);
+        UnloadImage(atlas.image);
+        atlas.valid = false;
+    }
+}
+
+// Same quads as DrawTexturePro without rotation, minus its per-call
+// setup. The batch limit is checked per chunk, outside rlBegin/rlEnd.
+static void DrawSprites(const SpriteInstance *list, int count)
+{
+    float width = (float)atlas.texture.width;
+    float height = (float)atlas.texture.height;
 
-    // Draw net lines on top of the water
-    for (int x = 0; x < screenWidth; x += NET_LINE_SPACING)
+    for (int first = 0; first < count; first += SPRITE_CHUNK)
     {
-        DrawLine(x, 0, x, screenHeight, Fade(LIGHTGRAY, 0.5f));
+        int last = (count - first > SPRITE_CHUNK) ? first + SPRITE_CHUNK : count;
+        rlCheckRenderBatchLimit(4 * (last - first));
+
+        rlSetTexture(atlas.texture.id);
+        rlBegin(RL_QUADS);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        for (int i = first; i < last; i++)
+        {
+            const SpriteInstance *s = &list[i];
+            const Rectangle *src = &atlas.source[s->sprite];
+            float u0 = src->x / width;
+            float v0 = src->y / height;
+            float u1 = (src->x + src->width) / width;
+            float v1 = (src->y + src->height) / height;
+
+            rlColor4ub(s->tint.r, s->tint.g, s->tint.b, s->tint.a);
+            rlTexCoord2f(u0, v0);
+            rlVertex2f(s->x, s->y);
+            rlTexCoord2f(u0, v1);
+            rlVertex2f(s->x, s->y + src->height);
+            rlTexCoord2f(u1, v1);
+            rlVertex2f(s->x + src->width, s->y + src->height);
+            rlTexCoord2f(u1, v0);
+            rlVertex2f(s->x + src->width, s->y);
+        }
+        rlEnd();
+        rlSetTexture(0);
     }
-    for (int y = 0; y < screenHeight; y += NET_LINE_SPACING)
+}
+
+// The same sprites with one shape or text call each
+static void DrawSpritesImmediate(const SpriteInstance *list, int count)
+{
+    for (int i = 0; i < count; i++)
     {
-        DrawLine(0, y, screenWidth, y, Fade(LIGHTGRAY, 0.5f));
+        const SpriteInstance *s = &list[i];
+        int x = (int)s->x;
+        int y = (int)s->y;
+        if (s->sprite == SPRITE_PROJECTILE)
+        {
+            DrawCircle(x + SPRITE_SIZE / 2, y + SPRITE_SIZE / 2, SPRITE_SIZE / 2.0f, s->tint);
+        }
+        else if (s->sprite == SPRITE_HULL)
+        {
+            DrawRectangle(x, y, SPRITE_SIZE, SPRITE_SIZE, s->tint);
+        }
+        else if (s->sprite < SPRITE_COUNT)
+        {
+            char letter[2] = {(char)('A' + s->sprite - SPRITE_LABEL), '\0'};
+            DrawText(letter, x + SPRITE_SIZE / 4, y + SPRITE_SIZE / 4, SPRITE_SIZE / 2, s->tint);
+        }
+        else
+        {
+            DrawTextureRec(atlas.texture, atlas.source[s->sprite], (Vector2){s->x, s->y}, s->tint);
+        }
     }
 }
 
 // ---------------------------------------------------------------------
-//  DrawGame
+//  HUD text cache
+//    Strings are formatted and rasterized once per distinct value into
+//    the atlas (shelf packed below the sprites), then drawn as sprites
+//    like everything else. When the space runs out the strings not yet
+//    cached are skipped for the rest of the frame, and the next frame
+//    starts from an empty cache.
 // ---------------------------------------------------------------------
-void DrawGame(const GameState *game)
+// Sprite of the string for (kind, value), or -1 if it does not fit
+static int HudText(HudKind kind, int value)
 {
-    int screenWidth = MAP_WIDTH * SCREEN_SCALE;
-    int screenHeight = MAP_HEIGHT * SCREEN_SCALE;
+    for (int e = 0; e < atlas.textCount; e++)
+    {
+        if (atlas.textKeys[e].kind == kind && atlas.textKeys[e].value == value)
+            return SPRITE_COUNT + e;
+    }
+    if (atlas.textCount == HUD_ENTRIES)
+    {
+        atlas.textFull = true;
+        return -1;
+    }
 
-    // Draw the bay background with net lines
-    DrawBayBackground(screenWidth, screenHeight);
+    char text[96];
+    FormatHud(kind, value, text, sizeof(text));
+    const HudStyle *style = &hudStyles[kind];
+    int width = MeasureText(text, style->fontSize);
+    if (width > ATLAS_WIDTH - 2)
+        width = ATLAS_WIDTH - 2;
 
-    // Next, draw obstacles from the map
-    for (int r = 0; r < MAP_HEIGHT; r++)
+    // Next shelf when this one is full; 1 pixel gutter all round
+    if (atlas.shelfX + width + 2 > ATLAS_WIDTH)
     {
-        for (int c = 0; c < MAP_WIDTH; c++)
-        {
-            char cell = game->map[r][c];
-            if (cell == '#' || cell == 'X')
-            {
-                // Represent obstacles or boundary (X or #) as gray squares
-                DrawRectangle(c * SCREEN_SCALE, r * SCREEN_SCALE,
-                              SCREEN_SCALE, SCREEN_SCALE, DARKGRAY);
-            }
-        }
+        atlas.shelfX = 0;
+        atlas.shelfY += atlas.shelfHeight;
+        atlas.shelfHeight = 0;
+    }
+    if (atlas.shelfY + style->fontSize + 2 > ATLAS_HEIGHT)
+    {
+        atlas.textFull = true;
+        return -1;
     }
 
-    // Draw projectiles
-    for (int i = 0; i < MAX_PLAYERS; i++)
+    int x = atlas.shelfX + 1;
+    int y = atlas.shelfY + 1;
+    ImageDrawText(&atlas.image, text, x, y, style->fontSize, style->color);
+    UpdateTexture(atlas.texture, atlas.image.data);
+
+    int e = atlas.textCount++;
+    atlas.textKeys[e] = (HudKey){kind, value};
+    atlas.source[SPRITE_COUNT + e] = (Rectangle){(float)x, (float)y, (float)width,
+                                                 (float)style->fontSize};
+    atlas.shelfX += width + 2;
+    if (style->fontSize + 2 > atlas.shelfHeight)
+        atlas.shelfHeight = style->fontSize + 2;
+    return SPRITE_COUNT + e;
+}
+
+// Only runs on a cache miss
+static void FormatHud(HudKind kind, int value, char *text, size_t size)
+{
+    switch (kind)
     {
-        for (int j = 0; j < MAX_PROJECTILES; j++)
+    case HUD_HP:
+        snprintf(text, size, "HP:%d", value);
+        break;
+    case HUD_WINNER:
+        if (value < 0)
+            snprintf(text, size, "TIE! Nobody survived!");
+        else
+            snprintf(text, size, "GAME OVER! Winner: %s", roster.names[value]);
+        break;
+    }
+}
+
+static void ClearHudText(void)
+{
+    ImageDrawRectangle(&atlas.image, 0, atlas.textTop, ATLAS_WIDTH,
+                       ATLAS_HEIGHT - atlas.textTop, BLANK);
+    UpdateTexture(atlas.texture, atlas.image.data);
+    atlas.textCount = 0;
+    atlas.shelfX = 0;
+    atlas.shelfY = atlas.textTop;
+    atlas.shelfHeight = 0;
+    atlas.textFull = false;
+    atlas.generation++;
+}
+
+// A cached string at screen (or world) pixel (x, y), outside the batch
+static void DrawHudText(HudKind kind, int value, int x, int y)
+{
+    int sprite = HudText(kind, value);
+    if (sprite >= 0)
+        DrawTextureRec(atlas.texture, atlas.source[sprite],
+                       (Vector2){(float)x, (float)y}, WHITE);
+}
+
+// Screen position between two ticks, alpha in [0, 1)
+static float Blend(int from, int to, float alpha)
+{
+    return (float)from + (float)(to - from) * alpha;
+}
+
+// Whether something drawn in cell (x, y) can show in `visible`; one
+// cell of slack for things drawn between two cells or overhanging
+static bool CellShown(CellRect visible, float x, float y)
+{
+    return x >= visible.x0 - 1 && x < visible.x1 + 1 &&
+           y >= visible.y0 - 1 && y < visible.y1 + 1;
+}
+
+// Ids of the ships (player index) and projectiles (MAX_PLAYERS + pool
+// position) within two cells of `visible`, into visibleIds; returns
+// how many
+static int CollectVisible(const GameState *game, CellRect visible)
+{
+    GridInit(&entityGrid, entityGridStorage, ENTITY_CAPACITY);
+    GridBegin(&entityGrid, game->map, game->playerCount + game->projectiles.count);
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *ship = &game->ships[i];
+        if (ship->hp > 0)
+            GridAdd(&entityGrid, i, ship->x, ship->y);
+    }
+
+    const ProjectileStore *store = &game->projectiles;
+    for (int i = 0; i < store->count; i++)
+        GridAdd(&entityGrid, MAX_PLAYERS + i, store->x[i], store->y[i]);
+    GridFinish(&entityGrid);
+
+    return GridQueryRect(&entityGrid, visible.x0 - 2, visible.y0 - 2,
+                         visible.x1 + 2, visible.y1 + 2, visibleIds, ENTITY_CAPACITY);
+}
+
+// ---------------------------------------------------------------------
+//  DrawGame
+//    Moving things are drawn between their `previous` and `game`
+//    positions; the static layer and HP come from `game`. Only what
+//    the camera sees is drawn, projectiles, ships and their HP as one
+//    sprite batch. Returns how many sprites were drawn.
+// ---------------------------------------------------------------------
+int DrawGame(const GameState *previous, const GameState *game, float alpha,
+             const Camera2D *camera)
+{
+    CellRect visible = VisibleCells(camera, game->map);
+
+    // Texture passes reset the transform, so refresh the cache before
+    // entering the camera
+    PrepareStaticLayer(game->map, camera, visible);
+    PrepareAtlas();
+
+    BeginMode2D(*camera);
+
+    // Bay background, net lines and obstacles from the cached texture
+    DrawStaticLayer();
+
+    int count = CollectSprites(previous, game, alpha, visible);
+    if (drawImmediate)
+        DrawSpritesImmediate(sprites, count);
+    else
+        DrawSprites(sprites, count);
+
+    EndMode2D();
+    return count;
+}
+
+// The sprites DrawGame draws, into `sprites`; returns how many
+static int CollectSprites(const GameState *previous, const GameState *game, float alpha,
+                          CellRect visible)
+{
+    // Ships and projectiles that can show: CellShown's one cell of
+    // slack plus at most one cell moved since `previous`
+    int shown = CollectVisible(game, visible);
+    int count = 0;
+
+    // Projectiles, centred in their cell
+    const ProjectileStore *store = &game->projectiles;
+    const ProjectileStore *before = &previous->projectiles;
+    for (int v = 0; v < shown; v++)
+    {
+        int i = visibleIds[v] - MAX_PLAYERS;
+        if (i >= 0)
         {
-            const Projectile *p = &game->players[i].ship.projectiles[j];
-            if (p->active)
+            float px = (float)store->x[i];
+            float py = (float)store->y[i];
+            // Same id last tick, wherever the pool kept it; fired this
+            // tick: nothing to blend from
+            int was = ProjectileIndex(before, store->id[i]);
+            if (was >= 0)
             {
-                Color col = (i == 0) ? RED : GREEN;
-                DrawCircle(p->x * SCREEN_SCALE + SCREEN_SCALE / 2,
-                           p->y * SCREEN_SCALE + SCREEN_SCALE / 2,
-                           SCREEN_SCALE / 4.0f, col);
+                px = Blend(before->x[was], store->x[i], alpha);
+                py = Blend(before->y[was], store->y[i], alpha);
             }
+            if (!CellShown(visible, px, py))
+                continue;
+            sprites[count++] = (SpriteInstance){
+                px * SCREEN_SCALE + (SCREEN_SCALE - SPRITE_SIZE) / 2.0f,
+                py * SCREEN_SCALE + (SCREEN_SCALE - SPRITE_SIZE) / 2.0f,
+                SPRITE_PROJECTILE, playerColors[store->owner[i] % PLAYER_COLORS]};
         }
     }
 
-    // Draw ships
-    for (int i = 0; i < MAX_PLAYERS; i++)
+    // Ships: hull in the bottom-right of the cell, label on top
+    int labels = 0;
+    for (int v = 0; v < shown; v++)
     {
-        if (game->players[i].ship.hp > 0)
+        int i = visibleIds[v];
+        if (i < MAX_PLAYERS && game->ships[i].hp > 0)
         {
-            // Ship color
-            Color shipColor = (i == 0) ? RED : GREEN;
-            // Label character
-            char labelStr[2] = {(i == 0) ? 'A' : 'B', '\0'};
-
-            int shipSize = SCREEN_SCALE / 2; // 32×32 if SCREEN_SCALE=64
-            // Center it in the cell
-            int offset = (SCREEN_SCALE - shipSize); // 16 px offset
-
-            // The top-left corner of the current cell in pixels
-            int cellX = game->players[i].ship.x * SCREEN_SCALE;
-            int cellY = game->players[i].ship.y * SCREEN_SCALE;
-
-            // Drawing the ship
-            DrawRectangle(cellX + offset,
-                          cellY + offset,
-                          shipSize,
-                          shipSize,
-                          shipColor);
-
-            // Drawing the label on the ship
-            DrawText(labelStr,
-                     cellX + offset + shipSize / 4, // horizontally centering the text
-                     cellY + offset + shipSize / 4, // vertically centering
-                     shipSize / 2,                  // text size = half the ship size
-                     WHITE);
-
-            // Show HP above the ship
-            char hpStr[16];
-            snprintf(hpStr, sizeof(hpStr), "HP:%d", game->players[i].ship.hp);
-            DrawText(hpStr,
-                     cellX + offset,
-                     cellY + offset - 13,
-                     14, // slightly smaller font
-                     BLACK);
+            const Ship *from = &previous->ships[i];
+            const Ship *to = &game->ships[i];
+            float blendX = Blend(from->x, to->x, alpha);
+            float blendY = Blend(from->y, to->y, alpha);
+            if (!CellShown(visible, blendX, blendY))
+                continue;
+            float hullX = blendX * SCREEN_SCALE + (SCREEN_SCALE - SPRITE_SIZE);
+            float hullY = blendY * SCREEN_SCALE + (SCREEN_SCALE - SPRITE_SIZE);
+
+            sprites[count++] = (SpriteInstance){hullX, hullY, SPRITE_HULL,
+                                                playerColors[i % PLAYER_COLORS]};
+            sprites[count++] = (SpriteInstance){hullX, hullY,
+                                                SPRITE_LABEL + i % LABEL_LETTERS, WHITE};
+
+            int hp = HudText(HUD_HP, to->hp);
+            if (hp >= 0)
+                hpSprites[labels++] = (SpriteInstance){hullX, hullY - 13, hp, WHITE};
         }
     }
+
+    // HP above the ships, after all of them so no hull covers it
+    memcpy(&sprites[count], hpSprites, sizeof(SpriteInstance) * (size_t)labels);
+    return count + labels;
 }
 
 // ---------------------------------------------------------------------
-//  HandleInput
-//    Read the keyboard and set each player’s
-//    vx, vy, and possibly spawn projectiles
+//  DrawGameDirty
+//    Kiosk renderer: draws `game` as it is (no interpolation, so a
+//    frame without a tick changes nothing) into a canvas kept between
+//    frames. The sprites DrawGame would draw are compared with the ones
+//    the canvas shows, and only the cells under sprites that appeared
+//    or went away get their background and sprites repainted. That
+//    covers everything UpdateShips, UpdateProjectiles and CheckHits
+//    change without bookkeeping in the simulation. A new view, map or
+//    HUD cache, or too many dirty cells, repaint it all. Returns how
+//    many sprites were drawn into the canvas.
 // ---------------------------------------------------------------------
-static void HandleInput(GameState *game)
-{
-    // Reset velocities each frame
-    game->players[0].ship.vx = 0;
-    game->players[0].ship.vy = 0;
-    game->players[1].ship.vx = 0;
-    game->players[1].ship.vy = 0;
-
-    // Player1 (WASD) + Fire = Left Shift
-    if (IsKeyDown(KEY_W))
-        game->players[0].ship.vy = -MAX_SPEED;
-    if (IsKeyDown(KEY_S))
-        game->players[0].ship.vy = MAX_SPEED;
-    if (IsKeyDown(KEY_A))
-        game->players[0].ship.vx = -MAX_SPEED;
-    if (IsKeyDown(KEY_D))
-        game->players[0].ship.vx = MAX_SPEED;
-
-    if (IsKeyPressed(KEY_LEFT_SHIFT))
-    {
-        // Fire
-        for (int i = 0; i < MAX_PROJECTILES; i++)
+int DrawGameDirty(const GameState *game, const Camera2D *camera)
+{
+    CellRect visible = VisibleCells(camera, game->map);
+    PrepareStaticLayer(game->map, camera, visible);
+    PrepareAtlas();
+
+    int width = GetScreenWidth();
+    int height = GetScreenHeight();
+    if (canvas.valid && (canvas.target.texture.width != width ||
+                         canvas.target.texture.height != height))
+        UnloadCanvas();
+    bool full = !canvas.valid || canvas.map != game->map ||
+                canvas.generation != atlas.generation ||
+                memcmp(&canvas.camera, camera, sizeof(Camera2D)) != 0;
+    if (!canvas.valid)
+    {
+        canvas.target = LoadRenderTexture(width, height);
+        canvas.valid = true;
+    }
+
+    int count = CollectSprites(game, game, 0.0f, visible);
+    canvas.visible = visible;
+    if (!full)
+        full = !MarkChanges(count);
+
+    // `painted` takes the new list, so `sprites` is free to be trimmed
+    // down to the ones that need drawing
+    memcpy(canvas.painted, sprites, sizeof(SpriteInstance) * (size_t)count);
+    canvas.paintedCount = count;
+
+    int drawn = 0;
+    if (full || canvas.dirtyCount > 0)
+    {
+        BeginTextureMode(canvas.target);
+        BeginMode2D(*camera);
+        if (full)
+        {
+            ClearBackground(RAYWHITE);
+            DrawStaticLayer();
+            drawn = count;
+        }
+        else
         {
-            Projectile *p = &game->players[0].ship.projectiles[i];
-            if (!p->active)
+            int columns = visible.x1 - visible.x0;
+            for (int d = 0; d < canvas.dirtyCount; d++)
+                DrawStaticCell(visible.x0 + canvas.dirtyCells[d] % columns,
+                               visible.y0 + canvas.dirtyCells[d] / columns);
+
+            // Sprites reaching out of a repainted cell draw the same
+            // pixels again outside it
+            for (int s = 0; s < count; s++)
             {
-                int dx = game->players[0].ship.vx;
-                int dy = game->players[0].ship.vy;
-                if (dx == 0 && dy == 0)
-                    dy = -1; // default shoot upward if still
-
-                p->x = game->players[0].ship.x;
-                p->y = game->players[0].ship.y;
-                p->dx = dx;
-                p->dy = dy;
-                p->active = true;
-                break;
+                if (SpriteTouchesDirty(&sprites[s]))
+                    sprites[drawn++] = sprites[s];
             }
         }
+        DrawSprites(sprites, drawn);
+        EndMode2D();
+        EndTextureMode();
     }
 
-    // Player2 (arrows) + Fire = Right Shift
-    if (IsKeyDown(KEY_UP))
-        game->players[1].ship.vy = -MAX_SPEED;
-    if (IsKeyDown(KEY_DOWN))
-        game->players[1].ship.vy = MAX_SPEED;
-    if (IsKeyDown(KEY_LEFT))
-        game->players[1].ship.vx = -MAX_SPEED;
-    if (IsKeyDown(KEY_RIGHT))
-        game->players[1].ship.vx = MAX_SPEED;
+    for (int d = 0; d < canvas.dirtyCount; d++)
+        canvas.dirty[canvas.dirtyCells[d]] = 0;
+    canvas.dirtyCount = 0;
+    canvas.camera = *camera;
+    canvas.map = game->map;
+    canvas.generation = atlas.generation;
+
+    // Render textures are stored bottom-up, hence the negative height
+    DrawTextureRec(canvas.target.texture, (Rectangle){0, 0, (float)width, (float)-height},
+                   (Vector2){0, 0}, WHITE);
+    return drawn;
+}
+
+// Mark the cells under sprites that are in `sprites` but not in what
+// the canvas shows, or the other way round. False if that is so many
+// that repainting everything is cheaper.
+static bool MarkChanges(int count)
+{
+    CellRect v = canvas.visible;
+    int cells = (v.x1 - v.x0) * (v.y1 - v.y0);
+    if (cells > DIRTY_MAP_CELLS)
+        return false;
+    int limit = cells / DIRTY_MAX_SHARE;
+
+    // Each new sprite is matched with a painted twin not matched yet,
+    // found through a hash table of the painted ones
+    int slots = 2 * SPRITE_LIST_CAPACITY;
+    memset(canvas.lookup, 0, sizeof(canvas.lookup));
+    for (int p = 0; p < canvas.paintedCount; p++)
+    {
+        unsigned int h = SpriteHash(&canvas.painted[p]) % (unsigned int)slots;
+        while (canvas.lookup[h] != 0)
+            h = (h + 1) % (unsigned int)slots;
+        canvas.lookup[h] = p + 1;
+        canvas.matched[p] = false;
+    }
 
-    if (IsKeyPressed(KEY_RIGHT_SHIFT))
+    for (int s = 0; s < count; s++)
     {
-        // Fire
-        for (int i = 0; i < MAX_PROJECTILES; i++)
+        bool found = false;
+        unsigned int h = SpriteHash(&sprites[s]) % (unsigned int)slots;
+        while (canvas.lookup[h] != 0)
         {
-            Projectile *p = &game->players[1].ship.projectiles[i];
-            if (!p->active)
+            int p = canvas.lookup[h] - 1;
+            if (!canvas.matched[p] && SameSprite(&sprites[s], &canvas.painted[p]))
             {
-                int dx = game->players[1].ship.vx;
-                int dy = game->players[1].ship.vy;
-                if (dx == 0 && dy == 0)
-                    dy = -1;
-
-                p->x = game->players[1].ship.x;
-                p->y = game->players[1].ship.y;
-                p->dx = dx;
-                p->dy = dy;
-                p->active = true;
+                canvas.matched[p] = true;
+                found = true;
                 break;
             }
+            h = (h + 1) % (unsigned int)slots;
         }
+        if (!found && !MarkSprite(&sprites[s], limit))
+            return false;
+    }
+
+    for (int p = 0; p < canvas.paintedCount; p++)
+    {
+        if (!canvas.matched[p] && !MarkSprite(&canvas.painted[p], limit))
+            return false;
     }
+    return true;
 }
 
-// ---------------------------------------------------------------------
-//  UpdateShips
-//    - Attempt to move each ship in the direction of (vx, vy)
-//    - Check collision with obstacles
-// ---------------------------------------------------------------------
-static void UpdateShips(GameState *game)
+// Visible cells a sprite's quad overlaps
+static CellRect SpriteCells(const SpriteInstance *sprite)
 {
-    for (int i = 0; i < MAX_PLAYERS; i++)
-    {
-        Ship *ship = &game->players[i].ship;
-        int nx = ship->x + ship->vx;
-        int ny = ship->y + ship->vy;
+    const Rectangle *src = &atlas.source[sprite->sprite];
+    CellRect cells = {(int)floorf(sprite->x / SCREEN_SCALE),
+                      (int)floorf(sprite->y / SCREEN_SCALE),
+                      (int)floorf((sprite->x + src->width - 1.0f) / SCREEN_SCALE) + 1,
+                      (int)floorf((sprite->y + src->height - 1.0f) / SCREEN_SCALE) + 1};
+    CellRect v = canvas.visible;
+    cells.x0 = (cells.x0 < v.x0) ? v.x0 : cells.x0;
+    cells.y0 = (cells.y0 < v.y0) ? v.y0 : cells.y0;
+    cells.x1 = (cells.x1 > v.x1) ? v.x1 : cells.x1;
+    cells.y1 = (cells.y1 > v.y1) ? v.y1 : cells.y1;
+    return cells;
+}
 
-        // Collisions with map boundary or obstacle
-        if (nx < 0 || nx >= MAP_WIDTH ||
-            ny < 0 || ny >= MAP_HEIGHT ||
-            game->map[ny][nx] == '#' ||
-            game->map[ny][nx] == 'X')
+static bool MarkSprite(const SpriteInstance *sprite, int limit)
+{
+    CellRect v = canvas.visible;
+    CellRect cells = SpriteCells(sprite);
+    for (int y = cells.y0; y < cells.y1; y++)
+    {
+        for (int x = cells.x0; x < cells.x1; x++)
         {
-            // Collide: lose 1 HP, do not move
-            ship->hp--;
-            if (ship->hp <= 0)
-                game->gameOver = true;
+            int d = (y - v.y0) * (v.x1 - v.x0) + (x - v.x0);
+            if (canvas.dirty[d])
+                continue;
+            if (canvas.dirtyCount == limit)
+                return false;
+            canvas.dirty[d] = 1;
+            canvas.dirtyCells[canvas.dirtyCount++] = d;
         }
-        else
+    }
+    return true;
+}
+
+static bool SpriteTouchesDirty(const SpriteInstance *sprite)
+{
+    CellRect v = canvas.visible;
+    CellRect cells = SpriteCells(sprite);
+    for (int y = cells.y0; y < cells.y1; y++)
+    {
+        for (int x = cells.x0; x < cells.x1; x++)
         {
-            // No collision, update ship position
-            ship->x = nx;
-            ship->y = ny;
+            if (canvas.dirty[(y - v.y0) * (v.x1 - v.x0) + (x - v.x0)])
+                return true;
         }
     }
+    return false;
+}
+
+static unsigned int SpriteHash(const SpriteInstance *sprite)
+{
+    unsigned int h = (unsigned int)(int)sprite->x * 73856093u;
+    h ^= (unsigned int)(int)sprite->y * 19349663u;
+    h ^= (unsigned int)sprite->sprite * 83492791u;
+    h ^= ((unsigned int)sprite->tint.r << 24 | (unsigned int)sprite->tint.g << 16 |
+          (unsigned int)sprite->tint.b << 8 | sprite->tint.a);
+    return h;
+}
+
+static bool SameSprite(const SpriteInstance *a, const SpriteInstance *b)
+{
+    return a->x == b->x && a->y == b->y && a->sprite == b->sprite &&
+           a->tint.r == b->tint.r && a->tint.g == b->tint.g &&
+           a->tint.b == b->tint.b && a->tint.a == b->tint.a;
+}
+
+// One cell of the static layer cache (it holds every visible cell),
+// mapped the same way DrawStaticLayer maps the whole texture
+static void DrawStaticCell(int x, int y)
+{
+    const Texture2D *texture = &background.target.texture;
+    CellRect cells = background.cells;
+    float sizeX = (float)texture->width / (float)(cells.x1 - cells.x0);
+    float sizeY = (float)texture->height / (float)(cells.y1 - cells.y0);
+
+    // Bottom-up again: the cell's rows counted from the texture's end
+    Rectangle source = {(float)(x - cells.x0) * sizeX,
+                        (float)texture->height - (float)(y - cells.y0 + 1) * sizeY,
+                        sizeX, -sizeY};
+    DrawTexturePro(*texture, source,
+                   (Rectangle){(float)(x * SCREEN_SCALE), (float)(y * SCREEN_SCALE),
+                               SCREEN_SCALE, SCREEN_SCALE},
+                   (Vector2){0, 0}, 0.0f, WHITE);
+}
+
+static void UnloadCanvas(void)
+{
+    if (canvas.valid)
+    {
+        UnloadRenderTexture(canvas.target);
+        canvas.valid = false;
+    }
 }
 
 // ---------------------------------------------------------------------
-//  UpdateProjectiles
+//  Camera
+//    Zoom about the mouse cursor, pan with a right-button drag; the
+//    view is kept on the map (centred where the map is smaller)
 // ---------------------------------------------------------------------
-static void UpdateProjectiles(GameState *game)
+static void HandleCamera(Camera2D *camera, const GameMap *map)
 {
-    for (int i = 0; i < MAX_PLAYERS; i++)
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0.0f)
     {
-        for (int j = 0; j < MAX_PROJECTILES; j++)
-        {
-            Projectile *p = &game->players[i].ship.projectiles[j];
-            if (p->active)
-            {
-                int nx = p->x + p->dx;
-                int ny = p->y + p->dy;
-                if (nx < 0 || nx >= MAP_WIDTH ||
-                    ny < 0 || ny >= MAP_HEIGHT ||
-                    game->map[ny][nx] == '#' ||
-                    game->map[ny][nx] == 'X')
-                {
-                    // obstacle or boundary
-                    p->active = false;
-                }
-                else
-                {
-                    p->x = nx;
-                    p->y = ny;
-                }
-            }
-        }
+        // Anchor the world point under the cursor, then scale about it
+        Vector2 mouse = GetMousePosition();
+        camera->target = GetScreenToWorld2D(mouse, *camera);
+        camera->offset = mouse;
+        camera->zoom *= powf(ZOOM_STEP, wheel);
+    }
+
+    if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT))
+    {
+        Vector2 delta = GetMouseDelta();
+        camera->target.x -= delta.x / camera->zoom;
+        camera->target.y -= delta.y / camera->zoom;
+    }
+
+    if (IsKeyPressed(KEY_HOME))
+        ResetCamera(camera, map);
+
+    ClampCamera(camera, map);
+}
+
+// Zoom 1, centred on the map
+static void ResetCamera(Camera2D *camera, const GameMap *map)
+{
+    camera->offset = (Vector2){GetScreenWidth() / 2.0f, GetScreenHeight() / 2.0f};
+    camera->target = (Vector2){map->width * SCREEN_SCALE / 2.0f, map->height * SCREEN_SCALE / 2.0f};
+    camera->rotation = 0.0f;
+    camera->zoom = 1.0f;
+    ClampCamera(camera, map);
+}
+
+static void ClampCamera(Camera2D *camera, const GameMap *map)
+{
+    float screenWidth = (float)GetScreenWidth();
+    float screenHeight = (float)GetScreenHeight();
+    float mapWidth = (float)(map->width * SCREEN_SCALE);
+    float mapHeight = (float)(map->height * SCREEN_SCALE);
+
+    // No zooming out past the whole map (or past MIN_ZOOM on big maps)
+    float fit = fminf(fminf(screenWidth / mapWidth, screenHeight / mapHeight), 1.0f);
+    camera->zoom = fminf(fmaxf(camera->zoom, fmaxf(fit, MIN_ZOOM)), MAX_ZOOM);
+
+    // Visible world rectangle's left/top edge, kept on the map
+    float viewWidth = screenWidth / camera->zoom;
+    float viewHeight = screenHeight / camera->zoom;
+    float left = camera->target.x - camera->offset.x / camera->zoom;
+    float top = camera->target.y - camera->offset.y / camera->zoom;
+
+    if (viewWidth >= mapWidth)
+        left = (mapWidth - viewWidth) / 2.0f;
+    else
+        left = fminf(fmaxf(left, 0.0f), mapWidth - viewWidth);
+    if (viewHeight >= mapHeight)
+        top = (mapHeight - viewHeight) / 2.0f;
+    else
+        top = fminf(fmaxf(top, 0.0f), mapHeight - viewHeight);
+
+    camera->target.x = left + camera->offset.x / camera->zoom;
+    camera->target.y = top + camera->offset.y / camera->zoom;
+}
+
+// Map cells (at least partly) on screen
+static CellRect VisibleCells(const Camera2D *camera, const GameMap *map)
+{
+    Vector2 topLeft = GetScreenToWorld2D((Vector2){0, 0}, *camera);
+    Vector2 bottomRight = GetScreenToWorld2D(
+        (Vector2){(float)GetScreenWidth(), (float)GetScreenHeight()}, *camera);
+
+    CellRect cells = {(int)floorf(topLeft.x / SCREEN_SCALE), (int)floorf(topLeft.y / SCREEN_SCALE),
+                      (int)ceilf(bottomRight.x / SCREEN_SCALE), (int)ceilf(bottomRight.y / SCREEN_SCALE)};
+    return ClampCells(cells, map);
+}
+
+static CellRect ClampCells(CellRect cells, const GameMap *map)
+{
+    cells.x0 = (cells.x0 < 0) ? 0 : cells.x0;
+    cells.y0 = (cells.y0 < 0) ? 0 : cells.y0;
+    cells.x1 = (cells.x1 > map->width) ? map->width : cells.x1;
+    cells.y1 = (cells.y1 > map->height) ? map->height : cells.y1;
+    return cells;
+}
+
+// ---------------------------------------------------------------------
+//  HandleInput
+//    Read the keyboard into one tick of input bits per human player;
+//    the simulation turns them into vx, vy and projectiles
+// ---------------------------------------------------------------------
+static void HandleInput(InputFrame *input)
+{
+    memset(input, 0, sizeof(InputFrame));
+
+    for (int i = 0; i < HUMAN_PLAYERS; i++)
+    {
+        const KeyLayout *layout = &keyLayouts[i];
+        if (IsKeyDown(layout->up))
+            input->keys[i] |= INPUT_UP;
+        if (IsKeyDown(layout->down))
+            input->keys[i] |= INPUT_DOWN;
+        if (IsKeyDown(layout->left))
+            input->keys[i] |= INPUT_LEFT;
+        if (IsKeyDown(layout->right))
+            input->keys[i] |= INPUT_RIGHT;
+        if (IsKeyPressed(layout->fire))
+            input->keys[i] |= INPUT_FIRE;
     }
 }
 
+// Random keys for the players nobody is at the keyboard for, drawn per
+// tick (not per frame) so bots play the same at any frame rate
+static void BotInput(unsigned int *seed, InputFrame *input, int playerCount)
+{
+    InputFrame random;
+    RandomInput(seed, &random, playerCount);
+    for (int i = HUMAN_PLAYERS; i < playerCount; i++)
+        input->keys[i] = random.keys[i];
+}
+
 // ---------------------------------------------------------------------
-//  CheckHits
-//    - For each projectile, see if it hits the opposing ship
+//  PlayOnline
+//    One ship in a match on a monomaxia_server. Every tick the keys go
+//    to the server and into the local prediction, which is what gets
+//    drawn; authoritative states only correct it.
 // ---------------------------------------------------------------------
-static void CheckHits(GameState *game)
+static int PlayOnline(const char *host, int port)
 {
-    Ship *shipA = &game->players[0].ship;
-    Ship *shipB = &game->players[1].ship;
+    struct sockaddr_in server;
+    NetSocket *sock = malloc(sizeof(NetSocket));
+    NetClient *client = malloc(sizeof(NetClient));
+    Predictor *predictor = malloc(sizeof(Predictor));
+    GameState *previous = malloc(sizeof(GameState));
+    bool opened = sock != NULL && NetOpen(sock, 0);
+    if (client != NULL)
+        NetClientInit(client, 0);
 
-    // If either is already 0 HP, do nothing
-    if (shipA->hp <= 0 && shipB->hp <= 0)
+    if (!opened || client == NULL || predictor == NULL || previous == NULL ||
+        !NetResolve(host, port, &server) || !Connect(sock, &server, client))
     {
-        game->gameOver = true;
-        return;
+        fprintf(stderr, "No seat in a match on %s:%d\n", host, port);
+        if (opened)
+            NetClose(sock);
+        if (client != NULL)
+            NetClientFree(client);
+        free(sock);
+        free(client);
+        free(predictor);
+        free(previous);
+        return 1;
+    }
+
+    const GameMap *map = client->map;
+    PredictorInit(predictor, client->player);
+    *previous = client->setup;
+
+    int screenWidth = map->width * SCREEN_SCALE;
+    int screenHeight = map->height * SCREEN_SCALE;
+    if (screenWidth > MAX_WINDOW_WIDTH)
+        screenWidth = MAX_WINDOW_WIDTH;
+    if (screenHeight > MAX_WINDOW_HEIGHT)
+        screenHeight = MAX_WINDOW_HEIGHT;
+
+    SetConfigFlags(FLAG_VSYNC_HINT);
+    InitWindow(screenWidth, screenHeight, "Monomaxia on a Bay (online)");
+
+    Camera2D camera;
+    ResetCamera(&camera, map);
+
+    const double tickTime = 1.0 / client->tickRate;
+    double accumulator = 0.0;
+    unsigned char pendingFire = 0;
+    unsigned char packet[NET_MAX_PACKET];
+
+    while (!WindowShouldClose())
+    {
+        ReceiveStates(sock, client, predictor);
+
+        // Both layouts steer the one ship we have here
+        InputFrame input;
+        HandleInput(&input);
+        unsigned char keys = 0;
+        for (int i = 0; i < HUMAN_PLAYERS; i++)
+            keys |= input.keys[i];
+        pendingFire |= keys & INPUT_FIRE;
+        HandleCamera(&camera, map);
+
+        accumulator += GetFrameTime();
+        if (accumulator > MAX_FRAME_TIME)
+            accumulator = MAX_FRAME_TIME;
+
+        while (accumulator >= tickTime)
+        {
+            const GameState *shown = PredictorState(predictor);
+            CopyGameState(previous, (shown != NULL) ? shown : &client->setup);
+
+            keys = (unsigned char)((keys & ~INPUT_FIRE) | pendingFire);
+            pendingFire = 0;
+            NetSend(sock, &server, packet, NetClientInput(client, keys, packet));
+            PredictorStep(predictor, client->sequence, keys);
+            accumulator -= tickTime;
+        }
+        NetFlush(sock);
+
+        // Before the match starts (seats still empty) show its setup
+        const GameState *game = PredictorState(predictor);
+        if (game == NULL)
+            game = &client->setup;
+        float alpha = (float)(accumulator / tickTime);
+
+        BeginDrawing();
+        ClearBackground(RAYWHITE);
+        DrawGame(previous, game, alpha, &camera);
+        if (game->gameOver)
+            DrawHudText(HUD_WINNER, MatchWinner(game), 40, 10);
+        EndDrawing();
     }
 
-    // A's projectiles -> B
-    for (int i = 0; i < MAX_PROJECTILES; i++)
+    NetSend(sock, &server, packet, NetClientBye(client, packet));
+    NetClose(sock);
+
+    UnloadStaticLayer();
+    UnloadAtlas();
+    CloseWindow();
+
+    NetClientFree(client);
+    free(sock);
+    free(client);
+    free(predictor);
+    free(previous);
+    return 0;
+}
+
+// Say hello until the server seats us or turns us away
+static bool Connect(NetSocket *sock, const struct sockaddr_in *server, NetClient *client)
+{
+    unsigned char packet[NET_MAX_PACKET];
+    double deadline = NetNow() + CONNECT_TIMEOUT;
+    double nextHello = 0.0;
+
+    while (!client->welcomed && !client->rejected && NetNow() < deadline)
     {
-        Projectile *p = &shipA->projectiles[i];
-        if (p->active && p->x == shipB->x && p->y == shipB->y)
+        if (NetNow() >= nextHello)
         {
-            shipB->hp--;
-            p->active = false;
-            if (shipB->hp <= 0)
-            {
-                game->gameOver = true;
-                return;
-            }
+            NetSend(sock, server, packet, NetClientHello(client, packet));
+            NetFlush(sock);
+            nextHello = NetNow() + HELLO_INTERVAL;
         }
+
+        NetWait(&sock, 1, HELLO_INTERVAL / 4);
+        struct sockaddr_in from;
+        const unsigned char *data;
+        size_t length;
+        while (NetReceive(sock, &from, &data, &length))
+            NetClientHandle(client, data, length);
     }
+    return client->welcomed;
+}
 
-    // B's projectiles -> A
-    for (int i = 0; i < MAX_PROJECTILES; i++)
+static void ReceiveStates(NetSocket *sock, NetClient *client, Predictor *predictor)
+{
+    struct sockaddr_in from;
+    const unsigned char *data;
+    size_t length;
+    while (NetReceive(sock, &from, &data, &length))
     {
-        Projectile *p = &shipB->projectiles[i];
-        if (p->active && p->x == shipA->x && p->y == shipA->y)
+        if (NetClientHandle(client, data, length))
+            PredictorConfirm(predictor, NetClientState(client), client->applied, &client->used);
+    }
+}
+
+// ---------------------------------------------------------------------
+//  BenchDraw
+//    Random-input matches drawn as fast as possible, zoomed out as far
+//    as the camera goes; DrawGame is timed on its own and as part of
+//    the whole frame (including the swap)
+// ---------------------------------------------------------------------
+static int BenchDraw(const GameMap *map, int players, int screenWidth, int screenHeight,
+                     int frames)
+{
+    InitWindow(screenWidth, screenHeight, "Monomaxia on a Bay (benchmark)");
+
+    GameState game;
+    InitGame(&game, map, players);
+    GameState previous = game;
+    Camera2D camera;
+    ResetCamera(&camera, map);
+    camera.zoom = MIN_ZOOM;
+    ClampCamera(&camera, map);
+    unsigned int seed = 1;
+
+    double drawTime = 0.0;
+    long long spriteTotal = 0;
+    long long entityTotal = 0;
+    double start = GetTime();
+    int drawn = 0;
+    for (; drawn < frames && !WindowShouldClose(); drawn++)
+    {
+        CopyGameState(&previous, &game);
+        InputFrame input;
+        RandomInput(&seed, &input, game.playerCount);
+        SimStep(&game, &input);
+        // Random fleets sink fast, so big ones are restarted early to
+        // keep the screen about as full as it starts
+        if (game.gameOver || (drawn + 1) % BENCH_MATCH_TICKS == 0)
         {
-            shipA->hp--;
-            p->active = false;
-            if (shipA->hp <= 0)
-            {
-                game->gameOver = true;
-                return;
-            }
+            InitGame(&game, map, players);
+            CopyGameState(&previous, &game);
+        }
+
+        BeginDrawing();
+        ClearBackground(RAYWHITE);
+        double drawStart = GetTime();
+        int count = drawDirty ? DrawGameDirty(&game, &camera)
+                              : DrawGame(&previous, &game, 0.5f, &camera);
+        drawTime += GetTime() - drawStart;
+        EndDrawing();
+
+        // `sprites` still holds what was drawn: one hull per ship
+        spriteTotal += count;
+        for (int s = 0; s < count; s++)
+        {
+            if (sprites[s].sprite == SPRITE_HULL || sprites[s].sprite == SPRITE_PROJECTILE)
+                entityTotal++;
         }
     }
+    double total = GetTime() - start;
+
+    UnloadStaticLayer();
+    UnloadAtlas();
+    UnloadCanvas();
+    CloseWindow();
+
+    if (drawn == 0)
+        return 1;
+    printf("frames:       %d\n", drawn);
+    printf("entities:     %.0f/frame (%.0f sprites), %s\n", (double)entityTotal / drawn,
+           (double)spriteTotal / drawn,
+           drawDirty ? "repainted in changed cells" :
+           drawImmediate ? "one call each" : "batched");
+    printf("DrawGame:     %.1f us/frame\n", drawTime * 1e6 / drawn);
+    printf("whole frame:  %.1f us/frame\n", total * 1e6 / drawn);
+    return 0;
 }
@@ -0,0 +1,111 @@
+/*
+ * monomaxia_batch.c
+ *
+ * Tournament driver for the batch match runner: thousands of bot-vs-bot
+ * duels stepped in lockstep across all cores. Reports matches/sec and the
+ * latency of one batch tick (every match advanced once) as percentiles.
+ *
+ * Compile on terminal:
+ *    gcc -O2 -pthread monomaxia_batch.c batch.c simulation.c projectiles.c grid.c events.c -o monomaxia_batch
+ *
+ * Then run:
+ *    ./monomaxia_batch [matches] [ticks] [threads] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "batch.h"
+
+// ---------------------------------------------------------------------
+//  Helpers
+// ---------------------------------------------------------------------
+static long long NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int CompareLongLong(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of an already sorted array
+static long long Percentile(const long long *sorted, int count, double pct)
+{
+    int rank = (int)(pct / 100.0 * count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > count)
+        rank = count;
+    return sorted[rank - 1];
+}
+
+// ---------------------------------------------------------------------
+//  Main Entry
+// ---------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int matchCount = (argc > 1) ? atoi(argv[1]) : 10000;
+    int ticks = (argc > 2) ? atoi(argv[2]) : 1000;
+    int threads = (argc > 3) ? atoi(argv[3]) : 0;
+    unsigned int seed = (argc > 4) ? (unsigned int)strtoul(argv[4], NULL, 10) : 1;
+    if (matchCount <= 0 || ticks <= 0)
+    {
+        fprintf(stderr, "usage: %s [matches] [ticks] [threads] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    // One map shared read-only by every match
+    GameMap *map = MapCreate(DEFAULT_MAP_WIDTH, DEFAULT_MAP_HEIGHT);
+    BatchRunner *batch = (map != NULL) ? BatchCreate(map, matchCount, threads, seed) : NULL;
+    long long *latency = malloc(sizeof(long long) * (size_t)ticks);
+    if (batch == NULL || latency == NULL)
+    {
+        fprintf(stderr, "Failed to start batch runner\n");
+        BatchDestroy(batch);
+        MapFree(map);
+        free(latency);
+        return 1;
+    }
+
+    long long start = NowNs();
+    for (int t = 0; t < ticks; t++)
+    {
+        long long before = NowNs();
+        BatchStep(batch);
+        latency[t] = NowNs() - before;
+    }
+    double seconds = (double)(NowNs() - start) / 1e9;
+
+    BatchStats stats;
+    BatchGetStats(batch, &stats);
+    qsort(latency, (size_t)ticks, sizeof(long long), CompareLongLong);
+
+    printf("matches in flight: %d on %d threads\n", matchCount, BatchThreadCount(batch));
+    printf("batch ticks:       %d\n", ticks);
+    printf("match ticks:       %lld\n", stats.ticks);
+    printf("matches finished:  %lld (Player1 %lld, Player2 %lld, ties %lld)\n",
+           stats.matches, stats.wins[0], stats.wins[1], stats.ties);
+    printf("time:              %.3f s\n", seconds);
+    if (seconds > 0.0)
+    {
+        printf("matches/sec:       %.0f\n", (double)stats.matches / seconds);
+        printf("match ticks/sec:   %.0f\n", (double)stats.ticks / seconds);
+    }
+    printf("batch tick latency (us): p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+           Percentile(latency, ticks, 50) / 1e3,
+           Percentile(latency, ticks, 90) / 1e3,
+           Percentile(latency, ticks, 99) / 1e3,
+           latency[ticks - 1] / 1e3);
+
+    free(latency);
+    BatchDestroy(batch);
+    MapFree(map);
+    return 0;
+}
@@ -0,0 +1,1004 @@
+/*
+ * monomaxia_bench.c
+ *
+ * Micro-benchmarks for the simulation phases (UpdateShips,
+ * UpdateProjectiles, CheckHits, a full SimStep and InitGame) over a set
+ * of fixed scenarios, so a change to any of them can be measured and
+ * tracked over time.
+ *
+ * The "entities-N" rows compare the two ways of answering "which ship
+ * is on this projectile's cell": scanning every ship (HitsBruteForce)
+ * against rebuilding an occupancy grid and asking it (HitsGrid), for
+ * N ships and projectiles (half each) scattered over the map. One call
+ * resolves every projectile once.
+ *
+ * The "fleet-N" rows time the ship update loop over N ships in two
+ * layouts: ShipsNamed is the old one, every ship behind its player's
+ * 50-byte name with int fields (76 bytes a ship), Ships the Ship array
+ * GameState holds (10 bytes). Ships bounce off walls instead of losing
+ * hp, so every call moves the whole fleet; the l1d-miss column is the
+ * point of the comparison.
+ *
+ * The StateAssign and CopyGameState rows save each scenario's state
+ * into a ring, as the rollback and history rings do every tick: a plain
+ * struct assignment of the whole GameState against CopyGameState,
+ * which copies only the ships in play and the projectiles in flight.
+ *
+ * The "rollback-N" rows are what a predicting network client
+ * (prediction.h) pays when the server disagrees with a prediction N
+ * frames back: one call restores the authoritative state into the ring
+ * and simulates the N frames after it again.
+ *
+ * Compile on terminal:
+ *    gcc -O2 -pthread monomaxia_bench.c simulation.c projectiles.c grid.c events.c prediction.c \
+ *        -o monomaxia_bench
+ *
+ * Then run:
+ *    ./monomaxia_bench [--map WxH] [--players N] [--json results.json]
+ *                      [--min-time seconds] [--filter text]
+ *
+ * --map scales the bay up (default 20x10), --players the fleet (default
+ * a duel). The player, projectile and pool limits are compile-time
+ * settings, so bigger matches need their own binary:
+ *    gcc -O2 -pthread -DMAX_PLAYERS=1024 -DMAX_PROJECTILES=16 monomaxia_bench.c \
+ *        simulation.c projectiles.c grid.c events.c prediction.c -o monomaxia_bench_big
+ * (add e.g. -DPROJECTILE_CAPACITY=4096 to share a smaller pool).
+ *
+ * Every result is ns per call of the phase (one call = one tick). On
+ * Linux, cycles, instructions, L1D read misses and last-level cache
+ * misses per call are read from perf counters when the kernel allows it
+ * (perf_event_paranoid <= 2); otherwise those columns print "-" and are
+ * null in the JSON. DrawGame needs a window and is measured by the game
+ * itself, see monomaxia.c --bench-draw.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "grid.h"
+#include "prediction.h"
+#include "simulation.h"
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+#define DEFAULT_MIN_TIME 0.25     // seconds measured per benchmark
+#define BATCH 256                 // restored states per timed batch
+#define SIM_CHUNK 1024            // SimStep ticks per timed chunk
+#define DENSE_OBSTACLE_PERCENT 35 // open cells turned to 'X' in "dense"
+#define MAX_RESULTS 64
+#define OCCUPANCY_PASSES 16       // hit passes per timed batch
+#define FLEET_PASSES 16           // ship update passes per timed batch
+
+#define PERF_EVENTS 4
+
+// ---------------------------------------------------------------------
+//  Structs
+// ---------------------------------------------------------------------
+typedef struct
+{
+    int fd[PERF_EVENTS]; // -1 where the event could not be opened
+} PerfCounters;
+
+typedef struct
+{
+    const char *scenario;
+    const char *phase;
+    long long calls;
+    double nsPerCall;
+    bool hasPerf[PERF_EVENTS];
+    double perfPerCall[PERF_EVENTS];
+} BenchResult;
+
+typedef struct
+{
+    const char *name;
+    void (*setup)(GameMap *map, int players, GameState *game);
+} Scenario;
+
+typedef struct
+{
+    const char *name;
+    void (*run)(GameState *game);
+} Phase;
+
+// The ship layout before names left GameState, for the fleet rows
+typedef struct
+{
+    char name[50];
+    struct
+    {
+        int x, y, hp, vx, vy;
+        bool sunk;
+    } ship;
+} NamedShip;
+
+static const char *perfNames[PERF_EVENTS] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses"};
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void SetupEmpty(GameMap *map, int players, GameState *game);
+static void SetupDefault(GameMap *map, int players, GameState *game);
+static void SetupDense(GameMap *map, int players, GameState *game);
+static void SetupProjectiles(GameMap *map, int players, GameState *game);
+static void SetShipsMoving(GameState *game);
+static unsigned int NextRandom(unsigned int *seed);
+
+static void BenchPhase(const GameState *initial, const Phase *phase,
+                       double minTime, PerfCounters *perf, BenchResult *result);
+static void BenchSimStep(const GameState *initial, double minTime,
+                         PerfCounters *perf, BenchResult *result);
+static void BenchInitGame(const GameMap *map, int players, double minTime,
+                          PerfCounters *perf, BenchResult *result);
+static void BenchOccupancy(const GameMap *map, int entities, bool useGrid,
+                           double minTime, PerfCounters *perf, BenchResult *result);
+static void BenchFleet(const GameMap *map, int count, bool named,
+                       double minTime, PerfCounters *perf, BenchResult *result);
+static void MoveShips(Ship *ships, int count, const GameMap *map);
+static void MoveNamedShips(NamedShip *ships, int count, const GameMap *map);
+static void BenchCopy(const GameState *initial, bool live, double minTime,
+                      PerfCounters *perf, BenchResult *result);
+static void BenchRollback(const GameState *initial, int depth, double minTime,
+                          PerfCounters *perf, BenchResult *result);
+
+static void PerfOpen(PerfCounters *perf);
+static void PerfClose(PerfCounters *perf);
+static void PerfStart(PerfCounters *perf);
+static void PerfStop(PerfCounters *perf, long long totals[PERF_EVENTS]);
+static void FinishResult(BenchResult *result, double seconds, long long calls,
+                         const PerfCounters *perf, const long long totals[PERF_EVENTS]);
+
+static double Now(void);
+static void PrintResult(const BenchResult *result);
+static bool WriteJson(const char *path, const GameMap *map, int players,
+                      const BenchResult *results, int count);
+
+static const Scenario scenarios[] = {
+    {"empty", SetupEmpty},
+    {"default", SetupDefault},
+    {"dense", SetupDense},
+    {"projectiles", SetupProjectiles},
+};
+
+// Entity counts for the occupancy rows, with their scenario names
+static const int occupancySizes[] = {2, 64, 4096};
+static const char *occupancyNames[] = {"entities-2", "entities-64", "entities-4096"};
+
+// Fleet sizes for the layout rows: about L1, L2 and beyond for the
+// named layout
+static const int fleetSizes[] = {512, 4096, 65536};
+static const char *fleetNames[] = {"fleet-512", "fleet-4096", "fleet-65536"};
+
+// Rollback depths in frames, up to about a second at 60 Hz (the ring
+// holds PREDICT_HISTORY - 1)
+static const int rollbackDepths[] = {1, 4, 16, 60};
+static const char *rollbackNames[] = {"rollback-1", "rollback-4", "rollback-16", "rollback-60"};
+
+// Keeps the hit passes from being optimized away
+static volatile long long hitSink;
+
+static const Phase phases[] = {
+    {"UpdateShips", UpdateShips},
+    {"UpdateProjectiles", UpdateProjectiles},
+    {"CheckHits", CheckHits},
+};
+
+// ---------------------------------------------------------------------
+//  Main Entry
+// ---------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    const char *jsonPath = NULL;
+    const char *filter = NULL;
+    double minTime = DEFAULT_MIN_TIME;
+    int mapWidth = DEFAULT_MAP_WIDTH;
+    int mapHeight = DEFAULT_MAP_HEIGHT;
+    int players = DEFAULT_PLAYERS;
+
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "--map") == 0 && a + 1 < argc)
+        {
+            if (sscanf(argv[++a], "%dx%d", &mapWidth, &mapHeight) != 2)
+            {
+                fprintf(stderr, "--map expects WxH, e.g. 256x256\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[a], "--players") == 0 && a + 1 < argc)
+        {
+            players = atoi(argv[++a]);
+            if (players < 2 || players > MAX_PLAYERS)
+            {
+                fprintf(stderr, "--players must be 2..%d in this build\n", MAX_PLAYERS);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[a], "--json") == 0 && a + 1 < argc)
+            jsonPath = argv[++a];
+        else if (strcmp(argv[a], "--min-time") == 0 && a + 1 < argc)
+            minTime = atof(argv[++a]);
+        else if (strcmp(argv[a], "--filter") == 0 && a + 1 < argc)
+            filter = argv[++a];
+        else
+        {
+            fprintf(stderr, "Unknown argument %s\n", argv[a]);
+            return 1;
+        }
+    }
+    if (minTime <= 0.0)
+        minTime = DEFAULT_MIN_TIME;
+
+    // One map per scenario (they edit it), plus a pristine one
+    GameMap *map = MapCreate(mapWidth, mapHeight);
+    GameState *initial = malloc(sizeof(GameState));
+    if (map == NULL || initial == NULL)
+    {
+        fprintf(stderr, "Map must be %d..%d cells a side\n", MIN_MAP_SIZE, MAX_MAP_SIZE);
+        free(initial);
+        MapFree(map);
+        return 1;
+    }
+
+    PerfCounters perf;
+    PerfOpen(&perf);
+
+    printf("map %dx%d, %d players, %d projectiles each, pool %d, kernel %s\n\n",
+           mapWidth, mapHeight, players, MAX_PROJECTILES, PROJECTILE_CAPACITY,
+           ProjectileKernelName(ProjectilesBestKernel()));
+    printf("%-12s %-18s %10s %10s %10s %9s %9s\n",
+           "scenario", "phase", "ns/call", "cycles", "instr", "l1d-miss", "llc-miss");
+
+    BenchResult results[MAX_RESULTS];
+    int count = 0;
+    int scenarioCount = (int)(sizeof(scenarios) / sizeof(scenarios[0]));
+    int phaseCount = (int)(sizeof(phases) / sizeof(phases[0]));
+
+    for (int s = 0; s < scenarioCount; s++)
+    {
+        GameMap *scenarioMap = MapCreate(mapWidth, mapHeight);
+        if (scenarioMap == NULL)
+            break;
+        scenarios[s].setup(scenarioMap, players, initial);
+
+        for (int p = 0; p <= phaseCount; p++)
+        {
+            // The last "phase" is the whole tick
+            const char *phaseName = (p < phaseCount) ? phases[p].name : "SimStep";
+            if (filter != NULL && strstr(scenarios[s].name, filter) == NULL &&
+                strstr(phaseName, filter) == NULL)
+                continue;
+
+            if (p < phaseCount)
+                BenchPhase(initial, &phases[p], minTime, &perf, &results[count]);
+            else
+                BenchSimStep(initial, minTime, &perf, &results[count]);
+            results[count].scenario = scenarios[s].name;
+            PrintResult(&results[count]);
+            count++;
+        }
+
+        for (int c = 0; c < 2; c++)
+        {
+            const char *phaseName = c ? "CopyGameState" : "StateAssign";
+            if (filter != NULL && strstr(scenarios[s].name, filter) == NULL &&
+                strstr(phaseName, filter) == NULL)
+                continue;
+
+            BenchCopy(initial, c == 1, minTime, &perf, &results[count]);
+            results[count].scenario = scenarios[s].name;
+            PrintResult(&results[count]);
+            count++;
+        }
+
+        MapFree(scenarioMap);
+    }
+
+    if (filter == NULL || strstr("InitGame", filter) != NULL)
+    {
+        BenchInitGame(map, players, minTime, &perf, &results[count]);
+        PrintResult(&results[count]);
+        count++;
+    }
+
+    int sizeCount = (int)(sizeof(occupancySizes) / sizeof(occupancySizes[0]));
+    for (int n = 0; n < sizeCount; n++)
+    {
+        for (int g = 0; g < 2; g++)
+        {
+            const char *phaseName = g ? "HitsGrid" : "HitsBruteForce";
+            if (filter != NULL && strstr(occupancyNames[n], filter) == NULL &&
+                strstr(phaseName, filter) == NULL)
+                continue;
+
+            BenchOccupancy(map, occupancySizes[n], g == 1, minTime, &perf, &results[count]);
+            results[count].scenario = occupancyNames[n];
+            PrintResult(&results[count]);
+            count++;
+        }
+    }
+
+    int fleetCount = (int)(sizeof(fleetSizes) / sizeof(fleetSizes[0]));
+    for (int n = 0; n < fleetCount; n++)
+    {
+        for (int l = 0; l < 2; l++)
+        {
+            const char *phaseName = l ? "Ships" : "ShipsNamed";
+            if (filter != NULL && strstr(fleetNames[n], filter) == NULL &&
+                strstr(phaseName, filter) == NULL)
+                continue;
+
+            BenchFleet(map, fleetSizes[n], l == 0, minTime, &perf, &results[count]);
+            results[count].scenario = fleetNames[n];
+            PrintResult(&results[count]);
+            count++;
+        }
+    }
+
+    // From the start of a default match
+    int depthCount = (int)(sizeof(rollbackDepths) / sizeof(rollbackDepths[0]));
+    GameMap *rollbackMap = MapCreate(mapWidth, mapHeight);
+    if (rollbackMap != NULL)
+        SetupDefault(rollbackMap, players, initial);
+    for (int d = 0; d < depthCount && rollbackMap != NULL; d++)
+    {
+        if (filter != NULL && strstr(rollbackNames[d], filter) == NULL &&
+            strstr("Rollback", filter) == NULL)
+            continue;
+
+        BenchRollback(initial, rollbackDepths[d], minTime, &perf, &results[count]);
+        results[count].scenario = rollbackNames[d];
+        PrintResult(&results[count]);
+        count++;
+    }
+    MapFree(rollbackMap);
+
+    PerfClose(&perf);
+    free(initial);
+
+    bool ok = jsonPath == NULL || WriteJson(jsonPath, map, players, results, count);
+    if (!ok)
+        fprintf(stderr, "Cannot write %s\n", jsonPath);
+    MapFree(map);
+    return ok ? 0 : 1;
+}
+
+// ---------------------------------------------------------------------
+//  Scenarios
+//    Each builds the state every call of a phase starts from
+// ---------------------------------------------------------------------
+
+// Border walls only
+static void SetupEmpty(GameMap *map, int players, GameState *game)
+{
+    for (int r = 1; r < map->height - 1; r++)
+        for (int c = 1; c < map->width - 1; c++)
+            map->cells[(long)r * map->width + c] = '.';
+    BuildSolidMap(map);
+    InitGame(game, map, players);
+    SetShipsMoving(game);
+}
+
+// The map every match is played on
+static void SetupDefault(GameMap *map, int players, GameState *game)
+{
+    InitGame(game, map, players);
+    SetShipsMoving(game);
+}
+
+// About a third of the open water is rock, ship cells kept clear
+static void SetupDense(GameMap *map, int players, GameState *game)
+{
+    InitGame(game, map, players);
+    unsigned int seed = 12345;
+    for (int r = 1; r < map->height - 1; r++)
+        for (int c = 1; c < map->width - 1; c++)
+            if (NextRandom(&seed) % 100 < DENSE_OBSTACLE_PERCENT)
+                map->cells[(long)r * map->width + c] = 'X';
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *ship = &game->ships[i];
+        map->cells[(long)ship->y * map->width + ship->x] = '.';
+    }
+    BuildSolidMap(map);
+    SetShipsMoving(game);
+}
+
+// Every ship's projectiles in flight (as many as the pool holds), each
+// from a random open cell
+static void SetupProjectiles(GameMap *map, int players, GameState *game)
+{
+    InitGame(game, map, players);
+    SetShipsMoving(game);
+
+    unsigned int seed = 67890;
+    for (int owner = 0; owner < game->playerCount; owner++)
+    {
+        for (int k = 0; k < MAX_PROJECTILES; k++)
+        {
+            int x, y, dx, dy;
+            do
+            {
+                x = 1 + (int)(NextRandom(&seed) % (unsigned int)(map->width - 2));
+                y = 1 + (int)(NextRandom(&seed) % (unsigned int)(map->height - 2));
+            } while (MapCell(map, x, y) != '.');
+            do
+            {
+                dx = (int)(NextRandom(&seed) % 3) - 1;
+                dy = (int)(NextRandom(&seed) % 3) - 1;
+            } while (dx == 0 && dy == 0);
+
+            ProjectileFire(&game->projectiles, map, owner, x, y, dx, dy);
+        }
+    }
+}
+
+// Ships heading east and west in turn (players 1 and 2 towards each
+// other), so UpdateShips has moves to check
+static void SetShipsMoving(GameState *game)
+{
+    for (int i = 0; i < game->playerCount; i++)
+        game->ships[i].vx = (i % 2 == 0) ? MAX_SPEED : -MAX_SPEED;
+}
+
+static unsigned int NextRandom(unsigned int *seed)
+{
+    unsigned int x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+// ---------------------------------------------------------------------
+//  BenchPhase
+//    A batch of states is restored from the scenario (untimed), then
+//    the phase runs once on each (timed), until minTime is reached.
+//    Restoring keeps every call doing the same work; the states share
+//    the scenario's map, so the batch stays small even for huge maps.
+// ---------------------------------------------------------------------
+static void BenchPhase(const GameState *initial, const Phase *phase,
+                       double minTime, PerfCounters *perf, BenchResult *result)
+{
+    GameState *states = malloc(BATCH * sizeof(GameState));
+    long long totals[PERF_EVENTS] = {0};
+    long long calls = 0;
+    double seconds = 0.0;
+
+    while (seconds < minTime)
+    {
+        for (int b = 0; b < BATCH; b++)
+            memcpy(&states[b], initial, sizeof(GameState));
+
+        PerfStart(perf);
+        double start = Now();
+        for (int b = 0; b < BATCH; b++)
+            phase->run(&states[b]);
+        seconds += Now() - start;
+        PerfStop(perf, totals);
+
+        calls += BATCH;
+    }
+
+    result->phase = phase->name;
+    FinishResult(result, seconds, calls, perf, totals);
+
+    free(states);
+}
+
+// ---------------------------------------------------------------------
+//  BenchSimStep
+//    Whole ticks with random input from the scenario's start, the
+//    match restarted (untimed) whenever it ends
+// ---------------------------------------------------------------------
+static void BenchSimStep(const GameState *initial, double minTime,
+                         PerfCounters *perf, BenchResult *result)
+{
+    GameState game = *initial;
+    unsigned int seed = 1;
+    long long totals[PERF_EVENTS] = {0};
+    long long calls = 0;
+    double seconds = 0.0;
+
+    while (seconds < minTime)
+    {
+        int n = 0;
+        PerfStart(perf);
+        double start = Now();
+        while (n < SIM_CHUNK && !game.gameOver)
+        {
+            InputFrame input;
+            RandomInput(&seed, &input, game.playerCount);
+            SimStep(&game, &input);
+            n++;
+        }
+        seconds += Now() - start;
+        PerfStop(perf, totals);
+
+        calls += n;
+        if (game.gameOver)
+            game = *initial;
+    }
+
+    result->phase = "SimStep";
+    FinishResult(result, seconds, calls, perf, totals);
+}
+
+// ---------------------------------------------------------------------
+//  BenchInitGame
+//    Match setup on an existing map
+// ---------------------------------------------------------------------
+static void BenchInitGame(const GameMap *map, int players, double minTime,
+                          PerfCounters *perf, BenchResult *result)
+{
+    GameState game;
+    long long totals[PERF_EVENTS] = {0};
+    long long calls = 0;
+    double seconds = 0.0;
+
+    while (seconds < minTime)
+    {
+        PerfStart(perf);
+        double start = Now();
+        for (int i = 0; i < 64; i++)
+            InitGame(&game, map, players);
+        seconds += Now() - start;
+        PerfStop(perf, totals);
+        calls += 64;
+    }
+
+    result->scenario = "default";
+    result->phase = "InitGame";
+    FinishResult(result, seconds, calls, perf, totals);
+}
+
+// ---------------------------------------------------------------------
+//  BenchOccupancy
+//    `entities` / 2 ships and as many projectiles on random open cells
+//    of the map; every call finds, for each projectile, the first ship
+//    on its cell. The grid variant includes rebuilding the grid, as
+//    CheckHits does every tick.
+// ---------------------------------------------------------------------
+static void BenchOccupancy(const GameMap *map, int entities, bool useGrid,
+                           double minTime, PerfCounters *perf, BenchResult *result)
+{
+    int ships = (entities + 1) / 2;
+    int *x = malloc(sizeof(int) * (size_t)entities);
+    int *y = malloc(sizeof(int) * (size_t)entities);
+    int *storage = malloc(sizeof(int) * (size_t)GRID_STORAGE_INTS(ships));
+
+    // Ships first, then projectiles
+    unsigned int seed = 24680;
+    for (int e = 0; e < entities; e++)
+    {
+        do
+        {
+            x[e] = 1 + (int)(NextRandom(&seed) % (unsigned int)(map->width - 2));
+            y[e] = 1 + (int)(NextRandom(&seed) % (unsigned int)(map->height - 2));
+        } while (MapCell(map, x[e], y[e]) != '.');
+    }
+
+    OccupancyGrid grid;
+    GridInit(&grid, storage, ships);
+    long long totals[PERF_EVENTS] = {0};
+    long long calls = 0;
+    double seconds = 0.0;
+    long long hits = 0;
+
+    while (seconds < minTime)
+    {
+        PerfStart(perf);
+        double start = Now();
+        for (int pass = 0; pass < OCCUPANCY_PASSES; pass++)
+        {
+            if (useGrid)
+            {
+                GridBegin(&grid, map, ships);
+                for (int i = 0; i < ships; i++)
+                    GridAdd(&grid, i, x[i], y[i]);
+                GridFinish(&grid);
+
+                for (int p = ships; p < entities; p++)
+                {
+                    int target;
+                    if (GridQueryCell(&grid, x[p], y[p], &target, 1) > 0)
+                        hits += target;
+                }
+            }
+            else
+            {
+                for (int p = ships; p < entities; p++)
+                {
+                    for (int i = 0; i < ships; i++)
+                    {
+                        if (x[i] == x[p] && y[i] == y[p])
+                        {
+                            hits += i;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        seconds += Now() - start;
+        PerfStop(perf, totals);
+        calls += OCCUPANCY_PASSES;
+    }
+    hitSink = hits;
+
+    result->phase = useGrid ? "HitsGrid" : "HitsBruteForce";
+    FinishResult(result, seconds, calls, perf, totals);
+
+    free(storage);
+    free(y);
+    free(x);
+}
+
+// ---------------------------------------------------------------------
+//  BenchFleet
+//    `count` ships on random open cells, heading in random directions;
+//    every call moves each one as UpdateShips does
+// ---------------------------------------------------------------------
+static void BenchFleet(const GameMap *map, int count, bool named,
+                       double minTime, PerfCounters *perf, BenchResult *result)
+{
+    Ship *ships = malloc(sizeof(Ship) * (size_t)count);
+    NamedShip *namedShips = malloc(sizeof(NamedShip) * (size_t)count);
+
+    unsigned int seed = 13579;
+    for (int i = 0; i < count; i++)
+    {
+        Ship *ship = &ships[i];
+        do
+        {
+            ship->x = (short)(1 + NextRandom(&seed) % (unsigned int)(map->width - 2));
+            ship->y = (short)(1 + NextRandom(&seed) % (unsigned int)(map->height - 2));
+        } while (MapCell(map, ship->x, ship->y) != '.');
+        do
+        {
+            ship->vx = (signed char)((int)(NextRandom(&seed) % 3) - 1);
+            ship->vy = (signed char)((int)(NextRandom(&seed) % 3) - 1);
+        } while (ship->vx == 0 && ship->vy == 0);
+        ship->hp = 3;
+        ship->sunk = false;
+
+        snprintf(namedShips[i].name, sizeof(namedShips[i].name), "Player%d", i + 1);
+        namedShips[i].ship.x = ship->x;
+        namedShips[i].ship.y = ship->y;
+        namedShips[i].ship.hp = ship->hp;
+        namedShips[i].ship.vx = ship->vx;
+        namedShips[i].ship.vy = ship->vy;
+        namedShips[i].ship.sunk = false;
+    }
+
+    long long totals[PERF_EVENTS] = {0};
+    long long calls = 0;
+    double seconds = 0.0;
+
+    while (seconds < minTime)
+    {
+        PerfStart(perf);
+        double start = Now();
+        for (int pass = 0; pass < FLEET_PASSES; pass++)
+        {
+            if (named)
+                MoveNamedShips(namedShips, count, map);
+            else
+                MoveShips(ships, count, map);
+        }
+        seconds += Now() - start;
+        PerfStop(perf, totals);
+        calls += FLEET_PASSES;
+    }
+
+    result->phase = named ? "ShipsNamed" : "Ships";
+    FinishResult(result, seconds, calls, perf, totals);
+
+    free(namedShips);
+    free(ships);
+}
+
+// The two loops are the same but for the layout they walk
+static void MoveShips(Ship *ships, int count, const GameMap *map)
+{
+    for (int i = 0; i < count; i++)
+    {
+        Ship *ship = &ships[i];
+        if (ship->sunk)
+            continue;
+
+        int nx = ship->x + ship->vx;
+        int ny = ship->y + ship->vy;
+        if (SolidAt(map, nx, ny))
+        {
+            ship->vx = (signed char)-ship->vx;
+            ship->vy = (signed char)-ship->vy;
+        }
+        else
+        {
+            ship->x = (short)nx;
+            ship->y = (short)ny;
+        }
+    }
+}
+
+static void MoveNamedShips(NamedShip *ships, int count, const GameMap *map)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (ships[i].ship.sunk)
+            continue;
+
+        int nx = ships[i].ship.x + ships[i].ship.vx;
+        int ny = ships[i].ship.y + ships[i].ship.vy;
+        if (SolidAt(map, nx, ny))
+        {
+            ships[i].ship.vx = -ships[i].ship.vx;
+            ships[i].ship.vy = -ships[i].ship.vy;
+        }
+        else
+        {
+            ships[i].ship.x = nx;
+            ships[i].ship.y = ny;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+//  BenchCopy
+//    One call saves `initial` into the next slot of a ring as big as a
+//    predictor's, whole (`live` false) or with CopyGameState
+// ---------------------------------------------------------------------
+static void BenchCopy(const GameState *initial, bool live, double minTime,
+                      PerfCounters *perf, BenchResult *result)
+{
+    GameState *ring = malloc(PREDICT_HISTORY * sizeof(GameState));
+    for (int i = 0; i < PREDICT_HISTORY; i++)
+        ring[i] = *initial;
+
+    long long totals[PERF_EVENTS] = {0};
+    long long calls = 0;
+    double seconds = 0.0;
+
+    while (seconds < minTime)
+    {
+        PerfStart(perf);
+        double start = Now();
+        for (int i = 0; i < PREDICT_HISTORY; i++)
+        {
+            if (live)
+                CopyGameState(&ring[i], initial);
+            else
+                ring[i] = *initial;
+        }
+        seconds += Now() - start;
+        PerfStop(perf, totals);
+        calls += PREDICT_HISTORY;
+    }
+
+    result->phase = live ? "CopyGameState" : "StateAssign";
+    FinishResult(result, seconds, calls, perf, totals);
+    free(ring);
+}
+
+// ---------------------------------------------------------------------
+//  BenchRollback
+//    A predictor that ran PREDICT_HISTORY - 1 frames of random input
+//    ahead of `initial`; every call rolls back `depth` frames to it
+// ---------------------------------------------------------------------
+static void BenchRollback(const GameState *initial, int depth, double minTime,
+                          PerfCounters *perf, BenchResult *result)
+{
+    Predictor *predictor = malloc(sizeof(Predictor));
+    InputFrame none;
+    memset(&none, 0, sizeof(InputFrame));
+    PredictorInit(predictor, 0);
+    PredictorConfirm(predictor, initial, 0, &none);
+    unsigned int seed = 1;
+    for (unsigned int frame = 1; frame < PREDICT_HISTORY; frame++)
+    {
+        InputFrame input;
+        RandomInput(&seed, &input, 1);
+        PredictorStep(predictor, frame, input.keys[0]);
+    }
+
+    unsigned int from = predictor->frame - (unsigned int)depth;
+    long long totals[PERF_EVENTS] = {0};
+    long long calls = 0;
+    double seconds = 0.0;
+
+    while (seconds < minTime)
+    {
+        PerfStart(perf);
+        double start = Now();
+        for (int i = 0; i < 16; i++)
+            PredictorRollback(predictor, initial, from);
+        seconds += Now() - start;
+        PerfStop(perf, totals);
+        calls += 16;
+    }
+
+    result->phase = "Rollback";
+    FinishResult(result, seconds, calls, perf, totals);
+    free(predictor);
+}
+
+static void FinishResult(BenchResult *result, double seconds, long long calls,
+                         const PerfCounters *perf, const long long totals[PERF_EVENTS])
+{
+    result->calls = calls;
+    result->nsPerCall = seconds * 1e9 / (double)calls;
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        result->hasPerf[e] = perf->fd[e] >= 0;
+        result->perfPerCall[e] = (double)totals[e] / (double)calls;
+    }
+}
+
+// ---------------------------------------------------------------------
+//  Perf counters
+//    User-space only, one counter per event so a missing one (common
+//    in VMs for the cache events) does not take the others with it
+// ---------------------------------------------------------------------
+#ifdef __linux__
+static void PerfOpen(PerfCounters *perf)
+{
+    static const struct
+    {
+        unsigned int type;
+        unsigned long long config;
+    } events[PERF_EVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                 (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    };
+
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[e].type;
+        attr.config = events[e].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        perf->fd[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+static void PerfClose(PerfCounters *perf)
+{
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        if (perf->fd[e] >= 0)
+            close(perf->fd[e]);
+        perf->fd[e] = -1;
+    }
+}
+
+static void PerfStart(PerfCounters *perf)
+{
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        if (perf->fd[e] >= 0)
+        {
+            ioctl(perf->fd[e], PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+static void PerfStop(PerfCounters *perf, long long totals[PERF_EVENTS])
+{
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        long long value;
+        if (perf->fd[e] < 0)
+            continue;
+        ioctl(perf->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(perf->fd[e], &value, sizeof(value)) == (ssize_t)sizeof(value))
+            totals[e] += value;
+    }
+}
+#else
+static void PerfOpen(PerfCounters *perf)
+{
+    for (int e = 0; e < PERF_EVENTS; e++)
+        perf->fd[e] = -1;
+}
+
+static void PerfClose(PerfCounters *perf)
+{
+    (void)perf;
+}
+
+static void PerfStart(PerfCounters *perf)
+{
+    (void)perf;
+}
+
+static void PerfStop(PerfCounters *perf, long long totals[PERF_EVENTS])
+{
+    (void)perf;
+    (void)totals;
+}
+#endif
+
+// ---------------------------------------------------------------------
+//  Output
+// ---------------------------------------------------------------------
+static double Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void PrintResult(const BenchResult *result)
+{
+    printf("%-12s %-18s %10.1f", result->scenario, result->phase, result->nsPerCall);
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        int width = (e < 2) ? 10 : 9;
+        if (result->hasPerf[e])
+            printf(" %*.1f", width, result->perfPerCall[e]);
+        else
+            printf(" %*s", width, "-");
+    }
+    printf("\n");
+}
+
+static bool WriteJson(const char *path, const GameMap *map, int players,
+                      const BenchResult *results, int count)
+{
+    FILE *file = (strcmp(path, "-") == 0) ? stdout : fopen(path, "w");
+    if (file == NULL)
+        return false;
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"map_width\": %d,\n", map->width);
+    fprintf(file, "  \"map_height\": %d,\n", map->height);
+    fprintf(file, "  \"players\": %d,\n", players);
+    fprintf(file, "  \"projectiles_per_player\": %d,\n", MAX_PROJECTILES);
+    fprintf(file, "  \"projectile_pool\": %d,\n", PROJECTILE_CAPACITY);
+    fprintf(file, "  \"kernel\": \"%s\",\n", ProjectileKernelName(ProjectilesBestKernel()));
+    fprintf(file, "  \"results\": [\n");
+    for (int i = 0; i < count; i++)
+    {
+        const BenchResult *r = &results[i];
+        fprintf(file, "    {\"scenario\": \"%s\", \"phase\": \"%s\", \"calls\": %lld, \"ns_per_call\": %.2f",
+                r->scenario, r->phase, r->calls, r->nsPerCall);
+        for (int e = 0; e < PERF_EVENTS; e++)
+        {
+            if (r->hasPerf[e])
+                fprintf(file, ", \"%s\": %.2f", perfNames[e], r->perfPerCall[e]);
+            else
+                fprintf(file, ", \"%s\": null", perfNames[e]);
+        }
+        fprintf(file, "}%s\n", (i + 1 < count) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    bool ok = !ferror(file);
+    if (file != stdout && fclose(file) != 0)
+        ok = false;
+    return ok;
+}
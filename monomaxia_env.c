@@ -0,0 +1,140 @@
+/*
+ * monomaxia_env.c
+ *
+ * Throughput driver for the reinforcement-learning environment: a batch
+ * of self-play matches stepped with random actions, the way a trainer
+ * would step it between forward passes. Reports agent steps/sec (one
+ * action in, one observation and reward out) for the environment alone,
+ * the random actions are drawn outside the timing.
+ *
+ * Compile on terminal:
+ *    gcc -O2 -pthread monomaxia_env.c env.c simulation.c projectiles.c grid.c events.c -o monomaxia_env
+ *
+ * Or as a shared library for a Python trainer (ctypes / cffi):
+ *    gcc -O2 -shared -fPIC -pthread env.c simulation.c projectiles.c grid.c events.c -o libmonomaxia_env.so
+ *
+ * Then run:
+ *    ./monomaxia_env [matches] [steps] [threads] [players] [--features-only]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "env.h"
+
+// ---------------------------------------------------------------------
+//  Helpers
+// ---------------------------------------------------------------------
+static long long NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// ---------------------------------------------------------------------
+//  Main Entry
+// ---------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    EnvConfig config;
+    EnvDefaultConfig(&config);
+    int steps = 1000;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--features-only") == 0)
+        {
+            config.planes = false;
+            continue;
+        }
+        int value = atoi(argv[i]);
+        switch (positional++)
+        {
+            case 0: config.matchCount = value; break;
+            case 1: steps = value; break;
+            case 2: config.threads = value; break;
+            case 3: config.players = value; break;
+            default: break;
+        }
+    }
+    if (positional > 4 || config.matchCount <= 0 || steps <= 0)
+    {
+        fprintf(stderr, "usage: %s [matches] [steps] [threads] [players] [--features-only]\n",
+                argv[0]);
+        return 1;
+    }
+
+    // The trainer's side: every buffer allocated once and bound
+    size_t agents = (size_t)config.matchCount * (size_t)config.players;
+    size_t floats = EnvObservationFloats(&config);
+    unsigned char *actions = calloc(agents, 1);
+    float *observations = malloc(sizeof(float) * agents * floats);
+    float *rewards = malloc(sizeof(float) * agents);
+    unsigned char *dones = malloc((size_t)config.matchCount);
+    EnvBuffers buffers = { actions, observations, rewards, dones };
+
+    Env *env = (actions != NULL && observations != NULL && rewards != NULL && dones != NULL)
+                   ? EnvCreate(&config, &buffers)
+                   : NULL;
+    if (env == NULL)
+    {
+        fprintf(stderr, "Failed to start environment\n");
+        free(dones);
+        free(rewards);
+        free(observations);
+        free(actions);
+        return 1;
+    }
+
+    unsigned int seed = 1;
+    double rewardSum = 0.0;
+    long long stepNs = 0;
+    for (int s = 0; s < steps; s++)
+    {
+        for (int m = 0; m < config.matchCount; m++)
+        {
+            InputFrame input;
+            RandomInput(&seed, &input, config.players);
+            memcpy(actions + (size_t)m * config.players, input.keys, (size_t)config.players);
+        }
+
+        long long before = NowNs();
+        EnvStepBatch(env);
+        stepNs += NowNs() - before;
+
+        for (size_t a = 0; a < agents; a++)
+            rewardSum += rewards[a];
+    }
+    double seconds = (double)stepNs / 1e9;
+
+    EnvStats stats;
+    EnvGetStats(env, &stats);
+
+    printf("matches:           %d x %d players on %d threads\n",
+           config.matchCount, config.players, EnvThreadCount(env));
+    printf("observation:       %zu floats (%s)\n", floats,
+           config.planes ? "planes + features" : "features only");
+    printf("steps:             %lld\n", stats.steps);
+    printf("episodes:          %lld (timeouts %lld, ties %lld)\n",
+           stats.episodes, stats.timeouts, stats.ties);
+    printf("reward sum:        %.3f\n", rewardSum);
+    printf("step time:         %.3f s\n", seconds);
+    if (seconds > 0.0)
+    {
+        printf("agent steps/sec:   %.0f\n", (double)agents * stats.steps / seconds);
+        printf("match ticks/sec:   %.0f\n", (double)stats.ticks / seconds);
+        printf("obs bandwidth:     %.1f MB/s\n",
+               (double)agents * floats * sizeof(float) * stats.steps / seconds / 1e6);
+    }
+
+    EnvDestroy(env);
+    free(dones);
+    free(rewards);
+    free(observations);
+    free(actions);
+    return 0;
+}
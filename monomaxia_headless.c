@@ -0,0 +1,677 @@
+/*
+ * monomaxia_headless.c
+ *
+ * Runs the Monomaxia simulation without a window: random input for every
+ * player, back-to-back matches, as fast as the CPU allows. Used for
+ * server-side match resolution and load testing.
+ *
+ * Compile on terminal:
+ *    gcc -O2 -pthread monomaxia_headless.c simulation.c projectiles.c grid.c events.c replay.c \
+ *        snapshot.c bot.c -o monomaxia_headless -lm
+ *
+ * Then run:
+ *    ./monomaxia_headless [ticks] [seed] [players]
+ *
+ * Check the SIMD projectile kernels against the scalar reference
+ * (two games in lockstep, compared byte for byte every tick):
+ *    ./monomaxia_headless --verify [ticks] [seed] [players]
+ *
+ * Record one random-input match to a replay log, or re-simulate a log
+ * (from here or from the windowed game's --record) and check its state
+ * hashes:
+ *    ./monomaxia_headless --record match.mmxr [maxTicks] [seed] [players]
+ *    ./monomaxia_headless --replay match.mmxr
+ *
+ * Measure snapshot size (bytes/tick) and encode cost (ns/tick), full
+ * and delta against the previous tick, checking every round trip:
+ *    ./monomaxia_headless --snapshot [ticks] [seed] [players]
+ *
+ * Soak the computer player (bot.h): it steers Player2, who starts in
+ * the harder corner, with the default 2 ms per tick against random
+ * input for everyone else; compare its wins with a plain run's:
+ *    ./monomaxia_headless --ai [ticks] [seed] [players]
+ *
+ * Fast-forward long matches with many shots in flight: everyone moves
+ * and fires one tick in IDLE_VOLLEY_TICKS and sits still between, and
+ * every still stretch is stepped tick by tick in one game and jumped
+ * through with SimIdle in another (compared by hash), both timed. The
+ * bay is bigger so shots fly for longer:
+ *    ./monomaxia_headless --idle [ticks] [seed] [players] [WxH]
+ *
+ * Matches are duels unless [players] asks for more ships (up to
+ * MAX_PLAYERS of this build).
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bot.h"
+#include "replay.h"
+#include "simulation.h"
+#include "snapshot.h"
+
+static int Run(const GameMap *map, int players, long long ticks, unsigned int seed);
+static int Verify(const GameMap *map, int players, long long ticks, unsigned int seed);
+static int Record(const GameMap *map, int players, const char *path,
+                  long long maxTicks, unsigned int seed);
+static int Replay(const char *path);
+static int Snapshots(const GameMap *map, int players, long long ticks, unsigned int seed);
+static int PlayBot(const GameMap *map, int players, long long ticks, unsigned int seed);
+static int Idle(const GameMap *map, int players, long long ticks, unsigned int seed);
+static double ElapsedNs(const struct timespec *start, const struct timespec *end);
+static bool ParseNumber(const char *text, long long min, long long max, long long *value);
+static int BadValue(const char *what, const char *text, long long min, long long max);
+
+// --ai thinks for real time every tick, so it plays fewer by default
+#define AI_DEFAULT_TICKS 6000
+
+// --idle: one tick of moving and firing in this many, on a bigger bay
+#define IDLE_VOLLEY_TICKS 64
+#define IDLE_MAP_WIDTH 128
+#define IDLE_MAP_HEIGHT 128
+
+// ---------------------------------------------------------------------
+//  Main Entry
+// ---------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    // Optional mode flag first, then that mode's arguments
+    const char *mode = "";
+    if (argc > 1 && strncmp(argv[1], "--", 2) == 0)
+    {
+        mode = argv[1];
+        argc--;
+        argv++;
+    }
+
+    const char *path = NULL;
+    if (strcmp(mode, "--record") == 0 || strcmp(mode, "--replay") == 0)
+    {
+        if (argc < 2)
+        {
+            fprintf(stderr, "%s needs a replay file\n", mode);
+            return 1;
+        }
+        path = argv[1];
+        argc--;
+        argv++;
+    }
+
+    long long ticks = (strcmp(mode, "--ai") == 0) ? AI_DEFAULT_TICKS : 10000000;
+    if (argc > 1 && !ParseNumber(argv[1], 1, LLONG_MAX, &ticks))
+        return BadValue("ticks", argv[1], 1, LLONG_MAX);
+    long long value = 1;
+    if (argc > 2 && !ParseNumber(argv[2], 0, UINT_MAX, &value))
+        return BadValue("seed", argv[2], 0, UINT_MAX);
+    unsigned int seed = (value != 0) ? (unsigned int)value : 1;
+    value = DEFAULT_PLAYERS;
+    if (argc > 3 && !ParseNumber(argv[3], 2, MAX_PLAYERS, &value))
+        return BadValue("players", argv[3], 2, MAX_PLAYERS);
+    int players = (int)value;
+
+    // --replay rebuilds the recorded map, --idle takes its own size,
+    // every other mode plays on the default one
+    int mapWidth = DEFAULT_MAP_WIDTH;
+    int mapHeight = DEFAULT_MAP_HEIGHT;
+    if (strcmp(mode, "--idle") == 0)
+    {
+        mapWidth = IDLE_MAP_WIDTH;
+        mapHeight = IDLE_MAP_HEIGHT;
+        int used = 0;
+        if (argc > 4 && (sscanf(argv[4], "%dx%d%n", &mapWidth, &mapHeight, &used) != 2 ||
+                         argv[4][used] != '\0'))
+        {
+            fprintf(stderr, "--idle expects the map as WxH, e.g. 256x256\n");
+            return 1;
+        }
+    }
+    GameMap *map = MapCreate(mapWidth, mapHeight);
+    if (map == NULL)
+    {
+        fprintf(stderr, "Map must be %d..%d cells a side\n", MIN_MAP_SIZE, MAX_MAP_SIZE);
+        return 1;
+    }
+
+    int result;
+    if (strcmp(mode, "--verify") == 0)
+        result = Verify(map, players, ticks, seed);
+    else if (strcmp(mode, "--record") == 0)
+        result = Record(map, players, path, ticks, seed);
+    else if (strcmp(mode, "--replay") == 0)
+        result = Replay(path);
+    else if (strcmp(mode, "--snapshot") == 0)
+        result = Snapshots(map, players, ticks, seed);
+    else if (strcmp(mode, "--ai") == 0)
+        result = PlayBot(map, players, ticks, seed);
+    else if (strcmp(mode, "--idle") == 0)
+        result = Idle(map, players, ticks, seed);
+    else if (mode[0] == '\0')
+        result = Run(map, players, ticks, seed);
+    else
+    {
+        fprintf(stderr, "Unknown mode %s\n", mode);
+        result = 1;
+    }
+
+    MapFree(map);
+    return result;
+}
+
+// Whole-argument integers in [min, max], so "1e6" or "abc" is an error
+// rather than 1 or 0 ticks
+static bool ParseNumber(const char *text, long long min, long long max, long long *value)
+{
+    char *end;
+    errno = 0;
+    long long number = strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || number < min || number > max)
+        return false;
+    *value = number;
+    return true;
+}
+
+static int BadValue(const char *what, const char *text, long long min, long long max)
+{
+    fprintf(stderr, "%s must be a number from %lld to %lld, not \"%s\"\n", what, min, max, text);
+    return 1;
+}
+
+// ---------------------------------------------------------------------
+//  Run
+//    Back-to-back random-input matches, timed
+// ---------------------------------------------------------------------
+static int Run(const GameMap *map, int players, long long ticks, unsigned int seed)
+{
+    GameState game;
+    InitGame(&game, map, players);
+
+    long long matches = 0;
+    long long wins[MAX_PLAYERS] = {0};
+    long long ties = 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (long long t = 0; t < ticks; t++)
+    {
+        InputFrame input;
+        RandomInput(&seed, &input, players);
+        SimStep(&game, &input);
+
+        if (game.gameOver)
+        {
+            int winner = MatchWinner(&game);
+            if (winner < 0)
+                ties++;
+            else
+                wins[winner]++;
+
+            matches++;
+            InitGame(&game, map, players);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) +
+                     (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("kernel:     %s\n", ProjectileKernelName(ProjectilesBestKernel()));
+    printf("ticks:      %lld\n", ticks);
+    Roster roster;
+    InitRoster(&roster, game.playerCount);
+    printf("matches:    %lld (", matches);
+    for (int i = 0; i < game.playerCount; i++)
+        printf("%s %lld, ", roster.names[i], wins[i]);
+    printf("ties %lld)\n", ties);
+    printf("time:       %.3f s\n", seconds);
+    if (seconds > 0.0)
+        printf("ticks/sec:  %.0f\n", (double)ticks / seconds);
+
+    return 0;
+}
+
+// ---------------------------------------------------------------------
+//  PlayBot
+//    Like Run, with Player2 searching for its keys every tick
+// ---------------------------------------------------------------------
+static int PlayBot(const GameMap *map, int players, long long ticks, unsigned int seed)
+{
+    BotConfig config;
+    BotDefaultConfig(&config, 1);
+    config.seed = seed;
+    Bot *bot = BotCreate(&config);
+    if (bot == NULL)
+    {
+        fprintf(stderr, "Cannot start the bot\n");
+        return 1;
+    }
+
+    GameState game;
+    InitGame(&game, map, players);
+    long long matches = 0;
+    long long wins[MAX_PLAYERS] = {0};
+    long long ties = 0;
+
+    for (long long t = 0; t < ticks; t++)
+    {
+        InputFrame input;
+        RandomInput(&seed, &input, players);
+        input.keys[config.player] = BotThink(bot, &game);
+        SimStep(&game, &input);
+
+        if (game.gameOver)
+        {
+            int winner = MatchWinner(&game);
+            if (winner < 0)
+                ties++;
+            else
+                wins[winner]++;
+
+            matches++;
+            InitGame(&game, map, players);
+        }
+    }
+
+    BotStats stats;
+    BotGetStats(bot, &stats);
+    Roster roster;
+    InitRoster(&roster, players);
+
+    printf("bot:        %s, %d threads, %.1f ms a tick\n",
+           roster.names[config.player], BotThreadCount(bot), config.budget * 1000.0);
+    printf("ticks:      %lld\n", ticks);
+    printf("matches:    %lld (", matches);
+    for (int i = 0; i < players; i++)
+        printf("%s %lld, ", roster.names[i], wins[i]);
+    printf("ties %lld)\n", ties);
+    if (stats.thinks > 0)
+    {
+        printf("think:      %.3f ms mean, %.3f ms slowest\n",
+               stats.seconds * 1000.0 / (double)stats.thinks, stats.slowest * 1000.0);
+        printf("playouts:   %.0f a tick, %.0f simulated ticks/sec, tree depth up to %d\n",
+               (double)stats.playouts / (double)stats.thinks,
+               (double)stats.ticks / stats.seconds, stats.deepest);
+    }
+
+    BotDestroy(bot);
+    return 0;
+}
+
+// ---------------------------------------------------------------------
+//  Idle
+//    Both games get the same volleys; only the stretches in between
+//    are timed, stepped with an empty InputFrame or jumped by SimIdle
+// ---------------------------------------------------------------------
+static int Idle(const GameMap *map, int players, long long ticks, unsigned int seed)
+{
+    // A big build's GameState is too large for two on the stack
+    GameState *games = malloc(sizeof(GameState) * 2);
+    if (games == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    GameState *stepped = &games[0];
+    GameState *jumped = &games[1];
+    InitGame(stepped, map, players);
+    InitGame(jumped, map, players);
+
+    InputFrame none;
+    memset(&none, 0, sizeof(InputFrame));
+    long long matches = 0;
+    long long volleys = 0, stillTicks = 0;
+    long long inFlight = 0;
+    double steppedSeconds = 0.0, jumpedSeconds = 0.0;
+    struct timespec a, b, c;
+
+    long long t = 0;
+    while (t < ticks)
+    {
+        InputFrame input;
+        RandomInput(&seed, &input, players);
+        for (int i = 0; i < players; i++)
+            input.keys[i] |= INPUT_FIRE;
+        SimStep(stepped, &input);
+        SimStep(jumped, &input);
+        inFlight += stepped->projectiles.count;
+        volleys++;
+        t++;
+
+        int stretch = (ticks - t < IDLE_VOLLEY_TICKS - 1) ? (int)(ticks - t) : IDLE_VOLLEY_TICKS - 1;
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        int still = 0;
+        while (still < stretch && !stepped->gameOver)
+        {
+            SimStep(stepped, &none);
+            still++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        int skipped = SimIdle(jumped, stretch);
+        clock_gettime(CLOCK_MONOTONIC, &c);
+        stillTicks += still;
+        steppedSeconds += ElapsedNs(&a, &b) / 1e9;
+        jumpedSeconds += ElapsedNs(&b, &c) / 1e9;
+
+        if (skipped != still || HashGameState(stepped) != HashGameState(jumped))
+        {
+            printf("MISMATCH: SimIdle vs stepping, %d still ticks after tick %lld\n", stretch, t);
+            free(games);
+            return 1;
+        }
+        t += stretch;
+
+        if (stepped->gameOver)
+        {
+            matches++;
+            InitGame(stepped, map, players);
+            InitGame(jumped, map, players);
+        }
+    }
+
+    printf("map:        %dx%d, %d players, a volley every %d ticks\n",
+           map->width, map->height, players, IDLE_VOLLEY_TICKS);
+    printf("ticks:      %lld (%lld still, states match), %lld matches ended\n",
+           volleys + stillTicks, stillTicks, matches);
+    printf("in flight:  %.1f projectiles after a volley\n", (double)inFlight / (double)volleys);
+    if (steppedSeconds > 0.0 && jumpedSeconds > 0.0)
+    {
+        printf("stepped:    %.0f still ticks/sec\n", (double)stillTicks / steppedSeconds);
+        printf("SimIdle:    %.0f still ticks/sec (%.1fx)\n",
+               (double)stillTicks / jumpedSeconds, steppedSeconds / jumpedSeconds);
+    }
+    free(games);
+    return 0;
+}
+
+// ---------------------------------------------------------------------
+//  Verify
+//    Same input into a scalar-kernel game and a SIMD-kernel game, for
+//    every SIMD kernel this CPU runs; any byte of difference is a bug
+// ---------------------------------------------------------------------
+static int Verify(const GameMap *map, int players, long long ticks, unsigned int seed)
+{
+    ProjectileKernel best = ProjectilesBestKernel();
+    if (best == PROJECTILE_KERNEL_SCALAR)
+    {
+        printf("No SIMD kernel on this CPU, nothing to verify\n");
+        return 0;
+    }
+
+    for (int k = PROJECTILE_KERNEL_SCALAR + 1; k <= (int)best; k++)
+    {
+        unsigned int rng = seed;
+        GameState reference, candidate;
+        InitGame(&reference, map, players);
+        InitGame(&candidate, map, players);
+
+        for (long long t = 0; t < ticks; t++)
+        {
+            InputFrame input;
+            RandomInput(&rng, &input, players);
+
+            ProjectilesSetKernel(PROJECTILE_KERNEL_SCALAR);
+            SimStep(&reference, &input);
+            ProjectilesSetKernel((ProjectileKernel)k);
+            SimStep(&candidate, &input);
+
+            if (memcmp(&reference, &candidate, sizeof(GameState)) != 0)
+            {
+                printf("MISMATCH scalar vs %s at tick %lld\n",
+                       ProjectileKernelName((ProjectileKernel)k), t);
+                return 1;
+            }
+
+            if (reference.gameOver)
+            {
+                InitGame(&reference, map, players);
+                InitGame(&candidate, map, players);
+            }
+        }
+
+        printf("OK: %s matches scalar for %lld ticks\n",
+               ProjectileKernelName((ProjectileKernel)k), ticks);
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------
+//  Record
+//    One random-input match (or maxTicks) into a replay log
+// ---------------------------------------------------------------------
+static int Record(const GameMap *map, int players, const char *path,
+                  long long maxTicks, unsigned int seed)
+{
+    GameState game;
+    InitGame(&game, map, players);
+
+    ReplayWriter writer;
+    if (!ReplayWriterOpen(&writer, path, 60, &game))
+    {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return 1;
+    }
+
+    while (!game.gameOver && writer.ticks < maxTicks)
+    {
+        InputFrame input;
+        RandomInput(&seed, &input, players);
+        SimStep(&game, &input);
+        ReplayWriterTick(&writer, &input, &game);
+    }
+
+    long long ticks = writer.ticks;
+    if (!ReplayWriterClose(&writer))
+    {
+        fprintf(stderr, "Error writing %s\n", path);
+        return 1;
+    }
+    printf("recorded %lld ticks to %s\n", ticks, path);
+    return 0;
+}
+
+// ---------------------------------------------------------------------
+//  Replay
+//    Feed a log back into a fresh game, rolling the state hash every
+//    tick and comparing it at each checkpoint
+// ---------------------------------------------------------------------
+static int Replay(const char *path)
+{
+    ReplayReader reader;
+    if (!ReplayReaderOpen(&reader, path))
+    {
+        fprintf(stderr, "Cannot read replay %s\n", path);
+        return 1;
+    }
+
+    GameMap *map = MapCreate(reader.mapWidth, reader.mapHeight);
+    if (map == NULL)
+    {
+        fprintf(stderr, "Replay %s has an invalid %dx%d map\n",
+                path, reader.mapWidth, reader.mapHeight);
+        ReplayReaderClose(&reader);
+        return 1;
+    }
+
+    GameState game;
+    InitGame(&game, map, reader.playerCount);
+    unsigned long long hash = 0;
+    long long ticks = 0;
+    long long checkpoints = 0;
+    int result = 1;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (;;)
+    {
+        InputFrame input;
+        long long tick;
+        unsigned long long expected;
+        ReplayEvent event = ReplayReaderNext(&reader, &input, &tick, &expected);
+
+        if (event == REPLAY_TICK)
+        {
+            SimStep(&game, &input);
+            hash = ReplayRollHash(hash, &game);
+            ticks++;
+        }
+        else if (event == REPLAY_ERROR)
+        {
+            printf("CORRUPT: replay log unreadable after tick %lld\n", ticks);
+            break;
+        }
+        else if (tick != ticks || expected != hash)
+        {
+            printf("DESYNC: state differs within the %d ticks before tick %lld\n",
+                   REPLAY_CHECKPOINT_TICKS, tick);
+            break;
+        }
+        else if (event == REPLAY_CHECKPOINT)
+        {
+            checkpoints++;
+        }
+        else
+        {
+            result = 0;
+            break;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) +
+                     (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (result == 0)
+    {
+        printf("OK: %lld ticks, %lld checkpoints, final hash %016llx\n",
+               ticks, checkpoints, hash);
+        if (seconds > 0.0)
+            printf("replay speed: %.0f ticks/sec (%.0fx real time at %d Hz)\n",
+                   ticks / seconds, ticks / seconds / reader.tickRate, reader.tickRate);
+    }
+
+    ReplayReaderClose(&reader);
+    MapFree(map);
+    return result;
+}
+
+// ---------------------------------------------------------------------
+//  Snapshots
+//    States are simulated a block at a time and then encoded in a
+//    tight loop, so the timings hold encoding only
+// ---------------------------------------------------------------------
+#define SNAPSHOT_BLOCK 1024
+
+static double ElapsedNs(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) * 1e9 +
+           (double)(end->tv_nsec - start->tv_nsec);
+}
+
+static int Snapshots(const GameMap *map, int players, long long ticks, unsigned int seed)
+{
+    // states[0] is the tick before the block, states[1..] the block
+    GameState *states = malloc(sizeof(GameState) * (SNAPSHOT_BLOCK + 1));
+    unsigned char (*full)[SNAPSHOT_MAX_BYTES] = malloc(SNAPSHOT_BLOCK * SNAPSHOT_MAX_BYTES);
+    unsigned char (*delta)[SNAPSHOT_MAX_BYTES] = malloc(SNAPSHOT_BLOCK * SNAPSHOT_MAX_BYTES);
+    size_t *fullSize = malloc(sizeof(size_t) * SNAPSHOT_BLOCK);
+    size_t *deltaSize = malloc(sizeof(size_t) * SNAPSHOT_BLOCK);
+    if (states == NULL || full == NULL || delta == NULL || fullSize == NULL || deltaSize == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        free(deltaSize);
+        free(fullSize);
+        free(delta);
+        free(full);
+        free(states);
+        return 1;
+    }
+
+    long long done = 0;
+    long long fullBytes = 0, deltaBytes = 0;
+    double fullNs = 0.0, deltaNs = 0.0, decodeNs = 0.0;
+    int result = 0;
+
+    GameState game;
+    InitGame(&game, map, players);
+    states[0] = game;
+
+    while (done < ticks && result == 0)
+    {
+        int count = (ticks - done < SNAPSHOT_BLOCK) ? (int)(ticks - done) : SNAPSHOT_BLOCK;
+        for (int t = 1; t <= count; t++)
+        {
+            InputFrame input;
+            RandomInput(&seed, &input, players);
+            if (game.gameOver)
+                InitGame(&game, map, players);
+            SimStep(&game, &input);
+            CopyGameState(&states[t], &game);
+        }
+
+        struct timespec a, b, c, d;
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        for (int t = 1; t <= count; t++)
+            fullSize[t - 1] = SnapshotEncode(&states[t], NULL, full[t - 1], SNAPSHOT_MAX_BYTES);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        for (int t = 1; t <= count; t++)
+            deltaSize[t - 1] = SnapshotEncode(&states[t], &states[t - 1], delta[t - 1], SNAPSHOT_MAX_BYTES);
+        clock_gettime(CLOCK_MONOTONIC, &c);
+
+        // Receiver side: chain the deltas from the block's base state
+        GameState received = states[0];
+        for (int t = 1; t <= count && result == 0; t++)
+        {
+            if (!SnapshotDecode(delta[t - 1], deltaSize[t - 1], &received, &received) ||
+                HashGameState(&received) != HashGameState(&states[t]))
+            {
+                printf("MISMATCH: delta snapshot round trip at tick %lld\n", done + t);
+                result = 1;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &d);
+
+        for (int t = 1; t <= count && result == 0; t++)
+        {
+            GameState decoded;
+            InitGame(&decoded, map, players);
+            if (fullSize[t - 1] == 0 || deltaSize[t - 1] == 0 ||
+                !SnapshotDecode(full[t - 1], fullSize[t - 1], NULL, &decoded) ||
+                HashGameState(&decoded) != HashGameState(&states[t]))
+            {
+                printf("MISMATCH: full snapshot round trip at tick %lld\n", done + t);
+                result = 1;
+            }
+            fullBytes += (long long)fullSize[t - 1];
+            deltaBytes += (long long)deltaSize[t - 1];
+        }
+
+        fullNs += ElapsedNs(&a, &b);
+        deltaNs += ElapsedNs(&b, &c);
+        decodeNs += ElapsedNs(&c, &d);
+        states[0] = states[count];
+        done += count;
+    }
+
+    if (result == 0 && done > 0)
+    {
+        printf("ticks:            %lld (round trips OK)\n", done);
+        printf("raw GameState:    %zu bytes\n", sizeof(GameState));
+        printf("full snapshot:    %.2f bytes/tick, encode %.1f ns/tick\n",
+               (double)fullBytes / done, fullNs / done);
+        printf("delta snapshot:   %.2f bytes/tick, encode %.1f ns/tick, decode+check %.1f ns/tick\n",
+               (double)deltaBytes / done, deltaNs / done, decodeNs / done);
+    }
+
+    free(deltaSize);
+    free(fullSize);
+    free(delta);
+    free(full);
+    free(states);
+    return result;
+}
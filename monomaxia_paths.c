@@ -0,0 +1,247 @@
+/*
+ * monomaxia_paths.c
+ *
+ * Memory and build time of the distance fields (paths.h) on bays of
+ * growing size, and the cost of the lookups a bot makes every tick.
+ * For each map it builds the table, times PathNextKeys and
+ * PathDistance over random pairs of open cells, checks that following
+ * the keys really walks a shortest route, and times a refresh with the
+ * map unchanged and after one rock was added.
+ *
+ * Compile on terminal:
+ *    gcc -O2 -pthread monomaxia_paths.c paths.c simulation.c projectiles.c grid.c events.c \
+ *        -o monomaxia_paths
+ *
+ * Then run:
+ *    ./monomaxia_paths [WxH ...] [--rocks percent] [--max-mb megabytes]
+ *
+ * Maps default to 20x10 32x32 64x64 96x96, with the default obstacles
+ * only; --rocks turns that share of the open water into 'X' as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "paths.h"
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+#define DEFAULT_MAX_MB 512
+#define LOOKUP_PAIRS 4096  // Random pairs per timed pass
+#define LOOKUP_PASSES 256
+#define WALKED_ROUTES 1000 // Pairs whose route is walked and checked
+#define MAX_SIZES 16
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void Measure(int width, int height, int rocks, size_t maxBytes);
+static void AddRocks(GameMap *map, int percent, unsigned int *seed);
+static void RandomOpenCell(const GameMap *map, unsigned int *seed, short *x, short *y);
+static bool WalkRoute(const PathTable *paths, int x, int y, int toX, int toY);
+static unsigned int NextRandom(unsigned int *seed);
+static double Now(void);
+
+static volatile long long lookupSink;
+
+// ---------------------------------------------------------------------
+//  Main Entry
+// ---------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int widths[MAX_SIZES] = {20, 32, 64, 96};
+    int heights[MAX_SIZES] = {10, 32, 64, 96};
+    int sizeCount = 4;
+    bool sizesGiven = false;
+    int rocks = 0;
+    double maxMb = DEFAULT_MAX_MB;
+
+    for (int a = 1; a < argc; a++)
+    {
+        int w, h;
+        if (strcmp(argv[a], "--rocks") == 0 && a + 1 < argc)
+            rocks = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--max-mb") == 0 && a + 1 < argc)
+            maxMb = atof(argv[++a]);
+        else if (sscanf(argv[a], "%dx%d", &w, &h) == 2)
+        {
+            if (!sizesGiven)
+                sizeCount = 0;
+            sizesGiven = true;
+            if (sizeCount < MAX_SIZES)
+            {
+                widths[sizeCount] = w;
+                heights[sizeCount] = h;
+                sizeCount++;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [WxH ...] [--rocks percent] [--max-mb megabytes]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%-9s %7s %10s %10s %12s %12s %10s %10s %7s\n",
+           "map", "open", "table MB", "build ms", "ns/next", "ns/distance",
+           "us/same", "ms/edit", "routes");
+    for (int s = 0; s < sizeCount; s++)
+        Measure(widths[s], heights[s], rocks, (size_t)(maxMb * 1024 * 1024));
+    return 0;
+}
+
+// ---------------------------------------------------------------------
+//  Measure
+//    One row of the table for a width x height bay
+// ---------------------------------------------------------------------
+static void Measure(int width, int height, int rocks, size_t maxBytes)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%dx%d", width, height);
+
+    GameMap *map = MapCreate(width, height);
+    if (map == NULL)
+    {
+        printf("%-9s must be %d..%d cells a side\n", name, MIN_MAP_SIZE, MAX_MAP_SIZE);
+        return;
+    }
+    unsigned int seed = 24680;
+    AddRocks(map, rocks, &seed);
+
+    size_t bytes = PathsBytesFor(map);
+    double start = Now();
+    PathTable *paths = PathsCreate(map, maxBytes);
+    double buildSeconds = Now() - start;
+    if (paths == NULL)
+    {
+        printf("%-9s skipped, the table needs %.1f MB\n", name, (double)bytes / (1024 * 1024));
+        MapFree(map);
+        return;
+    }
+
+    short *pairs = malloc(sizeof(short) * 4 * LOOKUP_PAIRS);
+    if (pairs == NULL)
+    {
+        PathsDestroy(paths);
+        MapFree(map);
+        return;
+    }
+    for (int i = 0; i < LOOKUP_PAIRS; i++)
+    {
+        RandomOpenCell(map, &seed, &pairs[4 * i], &pairs[4 * i + 1]);
+        RandomOpenCell(map, &seed, &pairs[4 * i + 2], &pairs[4 * i + 3]);
+    }
+
+    long long sum = 0;
+    start = Now();
+    for (int pass = 0; pass < LOOKUP_PASSES; pass++)
+        for (int i = 0; i < LOOKUP_PAIRS; i++)
+            sum += PathNextKeys(paths, pairs[4 * i], pairs[4 * i + 1],
+                                pairs[4 * i + 2], pairs[4 * i + 3]);
+    double nextNs = (Now() - start) * 1e9 / ((double)LOOKUP_PASSES * LOOKUP_PAIRS);
+
+    start = Now();
+    for (int pass = 0; pass < LOOKUP_PASSES; pass++)
+        for (int i = 0; i < LOOKUP_PAIRS; i++)
+            sum += PathDistance(paths, pairs[4 * i], pairs[4 * i + 1],
+                                pairs[4 * i + 2], pairs[4 * i + 3]);
+    double distanceNs = (Now() - start) * 1e9 / ((double)LOOKUP_PASSES * LOOKUP_PAIRS);
+    lookupSink = sum;
+
+    int walked = 0;
+    for (int i = 0; i < WALKED_ROUTES && i < LOOKUP_PAIRS; i++)
+        walked += WalkRoute(paths, pairs[4 * i], pairs[4 * i + 1],
+                            pairs[4 * i + 2], pairs[4 * i + 3]);
+
+    // Unchanged map: a revision check. One more rock: a full rebuild.
+    start = Now();
+    for (int i = 0; i < 1000; i++)
+        PathsRefresh(paths);
+    double sameUs = (Now() - start) * 1e6 / 1000;
+
+    short rockX, rockY;
+    RandomOpenCell(map, &seed, &rockX, &rockY);
+    map->cells[(long)rockY * width + rockX] = 'X';
+    BuildSolidMap(map);
+    start = Now();
+    bool rebuilt = PathsRefresh(paths);
+    double editMs = (Now() - start) * 1e3;
+
+    printf("%-9s %7d %10.2f %10.1f %12.2f %12.2f %10.3f %10.1f %3d/%d%s\n",
+           name, PathsOpenCells(paths), (double)bytes / (1024 * 1024), buildSeconds * 1e3,
+           nextNs, distanceNs, sameUs, editMs, walked,
+           (WALKED_ROUTES < LOOKUP_PAIRS) ? WALKED_ROUTES : LOOKUP_PAIRS,
+           rebuilt ? "" : " (rebuild failed)");
+
+    free(pairs);
+    PathsDestroy(paths);
+    MapFree(map);
+}
+
+// Follows the keys from (x, y) as UpdateShips would move the ship,
+// checking every step is onto open water and one tick closer. With no
+// route there must be no keys either.
+static bool WalkRoute(const PathTable *paths, int x, int y, int toX, int toY)
+{
+    int distance = PathDistance(paths, x, y, toX, toY);
+    if (distance < 0)
+        return PathNextKeys(paths, x, y, toX, toY) == 0;
+
+    while (distance > 0)
+    {
+        unsigned char keys = PathNextKeys(paths, x, y, toX, toY);
+        int vx = ((keys & INPUT_RIGHT) != 0) - ((keys & INPUT_LEFT) != 0);
+        int vy = ((keys & INPUT_DOWN) != 0) - ((keys & INPUT_UP) != 0);
+        x += vx * MAX_SPEED;
+        y += vy * MAX_SPEED;
+        int left = PathDistance(paths, x, y, toX, toY);
+        if (keys == 0 || left != distance - 1)
+            return false;
+        distance = left;
+    }
+    return x == toX && y == toY;
+}
+
+// ---------------------------------------------------------------------
+//  Helpers
+// ---------------------------------------------------------------------
+static void AddRocks(GameMap *map, int percent, unsigned int *seed)
+{
+    if (percent <= 0)
+        return;
+    for (int r = 1; r < map->height - 1; r++)
+        for (int c = 1; c < map->width - 1; c++)
+            if (NextRandom(seed) % 100 < (unsigned int)percent)
+                map->cells[(long)r * map->width + c] = 'X';
+    BuildSolidMap(map);
+}
+
+static void RandomOpenCell(const GameMap *map, unsigned int *seed, short *x, short *y)
+{
+    do
+    {
+        *x = (short)(NextRandom(seed) % (unsigned int)map->width);
+        *y = (short)(NextRandom(seed) % (unsigned int)map->height);
+    } while (SolidAt(map, *x, *y));
+}
+
+static unsigned int NextRandom(unsigned int *seed)
+{
+    unsigned int x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+static double Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
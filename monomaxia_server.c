@@ -0,0 +1,544 @@
+/*
+ * monomaxia_server.c
+ *
+ * Authoritative Monomaxia server over UDP (see server.h), and a load
+ * generator that plays any number of random-input clients against it.
+ *
+ * Compile on terminal:
+ *    gcc -O2 -pthread monomaxia_server.c server.c netclient.c prediction.c net.c simulation.c \
+ *        projectiles.c grid.c events.c snapshot.c -o monomaxia_server
+ *
+ * Serve until Ctrl+C (or for --seconds), one report line per second:
+ *    ./monomaxia_server [--port 27960] [--players 2] [--tick-rate 60]
+ *                       [--map 20x10] [--matches 1024] [--seconds S]
+ *
+ * Play N random-input clients against a server:
+ *    ./monomaxia_server --bots N [--host 127.0.0.1] [--port 27960] [--seconds S]
+ *                       [--predict]
+ *
+ * Both at once on localhost: a server, and a bots process (forked)
+ * with enough clients to fill M matches, for --seconds (default 10):
+ *    ./monomaxia_server --loopback M [--players 2] [--tick-rate 60] [--predict]
+ *
+ * The server reports how late each tick started against its fixed
+ * schedule (jitter) and how long it took, as percentiles, and the
+ * bytes sent and received per client, payload and on the wire (with
+ * IPv4 + UDP headers). The bots decode every state and check it
+ * against the server's hash. With --predict every bot also runs
+ * client-side prediction (prediction.h) and reports how often and how
+ * deep it had to roll back.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "net.h"
+#include "netclient.h"
+#include "prediction.h"
+#include "server.h"
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+#define CLIENTS_PER_SOCKET 64 // Bots sharing one socket (and its buffer)
+#define MAX_BOT_SOCKETS 256   // NetWait limit
+#define HELLO_INTERVAL 0.25   // Seconds between hellos until welcomed
+
+// ---------------------------------------------------------------------
+//  Structs
+// ---------------------------------------------------------------------
+// Tick timings in seconds, appended as the server runs
+typedef struct
+{
+    double *late;
+    double *work;
+    int count, capacity;
+} TickTimes;
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static int RunServer(const ServerConfig *config, double seconds);
+static int RunBots(const char *host, int port, int count, double seconds, unsigned int seed,
+                   bool predict);
+static int RunLoopback(ServerConfig *config, int matches, double seconds, unsigned int seed,
+                       bool predict);
+static void PrintPrediction(const Predictor *predictors, int count, double elapsed);
+static bool AddTimes(TickTimes *times, double late, double work);
+static void PrintTimes(const char *label, double *values, int count);
+static void PrintWindow(double elapsed, const ServerStats *now, const ServerStats *before,
+                        TickTimes *window, double seconds);
+static int CompareDouble(const void *a, const void *b);
+static void OnSignal(int signal);
+
+static volatile sig_atomic_t stopRequested = 0;
+
+// ---------------------------------------------------------------------
+//  Main Entry
+// ---------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    ServerConfig config;
+    ServerDefaultConfig(&config);
+    const char *host = "127.0.0.1";
+    double seconds = 0.0;
+    int bots = 0;
+    int loopback = 0;
+    unsigned int seed = 1;
+    bool predict = false;
+
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "--port") == 0 && a + 1 < argc)
+            config.port = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--players") == 0 && a + 1 < argc)
+            config.playersPerMatch = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--tick-rate") == 0 && a + 1 < argc)
+            config.tickRate = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--map") == 0 && a + 1 < argc)
+            sscanf(argv[++a], "%dx%d", &config.mapWidth, &config.mapHeight);
+        else if (strcmp(argv[a], "--matches") == 0 && a + 1 < argc)
+            config.maxMatches = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--seconds") == 0 && a + 1 < argc)
+            seconds = atof(argv[++a]);
+        else if (strcmp(argv[a], "--bots") == 0 && a + 1 < argc)
+            bots = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--host") == 0 && a + 1 < argc)
+            host = argv[++a];
+        else if (strcmp(argv[a], "--loopback") == 0 && a + 1 < argc)
+            loopback = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc)
+            seed = (unsigned int)strtoul(argv[++a], NULL, 10);
+        else if (strcmp(argv[a], "--predict") == 0)
+            predict = true;
+        else
+        {
+            fprintf(stderr, "unknown argument: %s\n", argv[a]);
+            return 1;
+        }
+    }
+    if (seed == 0)
+        seed = 1;
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    if (loopback > 0)
+        return RunLoopback(&config, loopback, (seconds > 0.0) ? seconds : 10.0, seed, predict);
+    if (bots > 0)
+        return RunBots(host, config.port, bots, seconds, seed, predict);
+    return RunServer(&config, seconds);
+}
+
+static void OnSignal(int signal)
+{
+    (void)signal;
+    stopRequested = 1;
+}
+
+// ---------------------------------------------------------------------
+//  RunServer
+//    Fixed-rate tick loop: packets are handled while waiting for the
+//    next tick, then all matches step and send in one go. A tick that
+//    starts late does not move the schedule, so jitter does not add up.
+// ---------------------------------------------------------------------
+static int RunServer(const ServerConfig *config, double seconds)
+{
+    Server *server = ServerCreate(config);
+    if (server == NULL)
+    {
+        fprintf(stderr, "Failed to start a server for %d-player matches on port %d\n",
+                config->playersPerMatch, config->port);
+        return 1;
+    }
+    printf("serving %d-player matches on %dx%d, port %d, %d ticks/sec, up to %d matches\n",
+           config->playersPerMatch, config->mapWidth, config->mapHeight, config->port,
+           config->tickRate, config->maxMatches);
+    fflush(stdout);
+
+    TickTimes total = {0}, window = {0};
+    ServerStats stats, reported;
+    ServerGetStats(server, &reported);
+
+    double period = 1.0 / config->tickRate;
+    double start = NetNow();
+    double next = start;
+    double nextReport = start + 1.0;
+    double lastReport = start;
+    long long resyncs = 0;
+    bool ok = true;
+
+    while (!stopRequested && ok)
+    {
+        double now = NetNow();
+        if (seconds > 0.0 && now - start >= seconds)
+            break;
+        if (now < next)
+        {
+            ServerPoll(server, next - now);
+            continue;
+        }
+
+        ServerPoll(server, 0.0);
+        double begin = NetNow();
+        ServerTick(server);
+        double end = NetNow();
+        ok = AddTimes(&total, begin - next, end - begin) &&
+             AddTimes(&window, begin - next, end - begin);
+
+        next += period;
+        // More than a second behind: drop the missed ticks, no burst
+        if (end - next > 1.0)
+        {
+            next = end;
+            resyncs++;
+        }
+
+        if (end >= nextReport)
+        {
+            ServerGetStats(server, &stats);
+            PrintWindow(end - start, &stats, &reported, &window, end - lastReport);
+            reported = stats;
+            window.count = 0;
+            lastReport = end;
+            nextReport += 1.0;
+        }
+    }
+
+    double elapsed = NetNow() - start;
+    ServerGetStats(server, &stats);
+    printf("\nserver ran %.1f s: %lld ticks, %lld match ticks, %lld matches finished\n",
+           elapsed, stats.ticks, stats.matchTicks, stats.matchesFinished);
+    printf("schedule: %lld resyncs after falling a second behind\n", resyncs);
+    PrintTimes("tick lateness (us):", total.late, total.count);
+    PrintTimes("tick work (us):    ", total.work, total.count);
+    printf("states sent: %lld (%.1f%% delta)\n", stats.statesSent,
+           (stats.statesSent > 0) ? 100.0 * stats.deltaStates / stats.statesSent : 0.0);
+    printf("inputs received %lld, lost %lld, skipped %lld, starved ticks %lld\n",
+           stats.inputsReceived, stats.inputsLost, stats.inputsSkipped, stats.inputsStarved);
+    printf("hellos rejected %lld, seats timed out %lld, send errors %lld\n",
+           stats.rejected, stats.timeouts, stats.sendErrors);
+
+    free(total.late);
+    free(total.work);
+    free(window.late);
+    free(window.work);
+    ServerDestroy(server);
+    if (!ok)
+        fprintf(stderr, "Out of memory for tick timings\n");
+    return ok ? 0 : 1;
+}
+
+static void PrintWindow(double elapsed, const ServerStats *now, const ServerStats *before,
+                        TickTimes *window, double seconds)
+{
+    qsort(window->late, (size_t)window->count, sizeof(double), CompareDouble);
+    qsort(window->work, (size_t)window->count, sizeof(double), CompareDouble);
+    int n = window->count;
+    int clients = (now->clients > 0) ? now->clients : 1;
+    double sent = (double)(now->bytesSent - before->bytesSent);
+    double sentPackets = (double)(now->packetsSent - before->packetsSent);
+    double received = (double)(now->bytesReceived - before->bytesReceived);
+    double receivedPackets = (double)(now->packetsReceived - before->packetsReceived);
+
+    printf("%5.0fs %5d matches %6d clients | late us p50 %5.0f p99 %5.0f max %6.0f"
+           " | tick us p50 %5.0f p99 %5.0f | per client B/s out %5.0f (%5.0f wire)"
+           " in %5.0f (%5.0f wire)\n",
+           elapsed, now->matches, now->clients,
+           (n > 0) ? window->late[n / 2] * 1e6 : 0.0,
+           (n > 0) ? window->late[(n * 99) / 100] * 1e6 : 0.0,
+           (n > 0) ? window->late[n - 1] * 1e6 : 0.0,
+           (n > 0) ? window->work[n / 2] * 1e6 : 0.0,
+           (n > 0) ? window->work[(n * 99) / 100] * 1e6 : 0.0,
+           sent / clients / seconds,
+           (sent + sentPackets * NET_UDP_OVERHEAD) / clients / seconds,
+           received / clients / seconds,
+           (received + receivedPackets * NET_UDP_OVERHEAD) / clients / seconds);
+    fflush(stdout);
+}
+
+// ---------------------------------------------------------------------
+//  RunBots
+//    `count` clients, CLIENTS_PER_SOCKET to a socket, each sending
+//    random input at the server's tick rate on its own clock
+// ---------------------------------------------------------------------
+static int RunBots(const char *host, int port, int count, double seconds, unsigned int seed,
+                   bool predict)
+{
+    struct sockaddr_in server;
+    if (!NetResolve(host, port, &server))
+    {
+        fprintf(stderr, "Unknown host %s\n", host);
+        return 1;
+    }
+
+    int socketCount = (count + CLIENTS_PER_SOCKET - 1) / CLIENTS_PER_SOCKET;
+    if (socketCount > MAX_BOT_SOCKETS)
+    {
+        socketCount = MAX_BOT_SOCKETS;
+        count = socketCount * CLIENTS_PER_SOCKET;
+    }
+
+    NetClient *clients = malloc(sizeof(NetClient) * (size_t)count);
+    unsigned int *seeds = malloc(sizeof(unsigned int) * (size_t)count);
+    NetSocket *socks = malloc(sizeof(NetSocket) * (size_t)socketCount);
+    Predictor *predictors = predict ? malloc(sizeof(Predictor) * (size_t)count) : NULL;
+    NetSocket *waitOn[MAX_BOT_SOCKETS];
+    int opened = 0;
+    if (clients != NULL && seeds != NULL && socks != NULL && (predictors != NULL || !predict))
+    {
+        while (opened < socketCount && NetOpen(&socks[opened], 0))
+        {
+            waitOn[opened] = &socks[opened];
+            opened++;
+        }
+    }
+    if (opened < socketCount)
+    {
+        fprintf(stderr, "Failed to set up %d bots\n", count);
+        for (int s = 0; s < opened; s++)
+            NetClose(&socks[s]);
+        free(clients);
+        free(seeds);
+        free(socks);
+        free(predictors);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        NetClientInit(&clients[i], (unsigned int)i);
+        seeds[i] = seed + (unsigned int)i * 0x9E3779B9u;
+        if (seeds[i] == 0)
+            seeds[i] = 1;
+    }
+
+    unsigned char packet[NET_MAX_PACKET];
+    int tickRate = 0;
+    double start = NetNow();
+    double nextHello = start;
+    double nextInput = start;
+    while (!stopRequested)
+    {
+        double now = NetNow();
+        if (seconds > 0.0 && now - start >= seconds)
+            break;
+
+        if (now >= nextHello)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (!clients[i].welcomed && !clients[i].rejected)
+                    NetSend(&socks[i / CLIENTS_PER_SOCKET], &server, packet,
+                            NetClientHello(&clients[i], packet));
+            }
+            nextHello = now + HELLO_INTERVAL;
+        }
+
+        if (now >= nextInput && tickRate > 0)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                InputFrame input;
+                RandomInput(&seeds[i], &input, 1);
+                size_t length = NetClientInput(&clients[i], input.keys[0], packet);
+                if (length == 0)
+                    continue;
+                NetSend(&socks[i / CLIENTS_PER_SOCKET], &server, packet, length);
+                if (predict)
+                    PredictorStep(&predictors[i], clients[i].sequence, input.keys[0]);
+            }
+            nextInput += 1.0 / tickRate;
+            if (now - nextInput > 1.0)
+                nextInput = now;
+        }
+
+        for (int s = 0; s < socketCount; s++)
+            NetFlush(&socks[s]);
+
+        double wake = (tickRate > 0 && nextInput < nextHello) ? nextInput : nextHello;
+        NetWait(waitOn, socketCount, wake - NetNow());
+
+        for (int s = 0; s < socketCount; s++)
+        {
+            struct sockaddr_in from;
+            const unsigned char *data;
+            size_t length;
+            unsigned int nonce;
+            while (NetReceive(&socks[s], &from, &data, &length))
+            {
+                if (!NetPacketNonce(data, length, &nonce) || nonce >= (unsigned int)count ||
+                    (int)nonce / CLIENTS_PER_SOCKET != s)
+                    continue;
+                NetClient *client = &clients[nonce];
+                bool welcomed = client->welcomed;
+                bool newState = NetClientHandle(client, data, length);
+                if (predict && !welcomed && client->welcomed)
+                    PredictorInit(&predictors[nonce], client->player);
+                if (predict && newState)
+                    PredictorConfirm(&predictors[nonce], NetClientState(client),
+                                     client->applied, &client->used);
+                if (tickRate == 0 && client->welcomed)
+                {
+                    tickRate = client->tickRate;
+                    nextInput = NetNow();
+                }
+            }
+        }
+    }
+    double elapsed = NetNow() - start;
+
+    // Free the seats right away instead of waiting for the timeout
+    for (int i = 0; i < count; i++)
+    {
+        if (clients[i].welcomed)
+            NetSend(&socks[i / CLIENTS_PER_SOCKET], &server, packet,
+                    NetClientBye(&clients[i], packet));
+    }
+
+    int welcomed = 0, rejected = 0;
+    long long states = 0, deltas = 0, stale = 0, dropped = 0, mismatches = 0, missed = 0;
+    long long bytes = 0, packets = 0;
+    for (int i = 0; i < count; i++)
+    {
+        welcomed += clients[i].welcomed;
+        rejected += clients[i].rejected;
+        states += clients[i].statesReceived;
+        deltas += clients[i].deltaStates;
+        stale += clients[i].statesStale;
+        dropped += clients[i].statesDropped;
+        mismatches += clients[i].hashMismatches;
+        missed += clients[i].ticksMissed;
+        NetClientFree(&clients[i]);
+    }
+    for (int s = 0; s < socketCount; s++)
+    {
+        NetClose(&socks[s]);
+        bytes += socks[s].bytesReceived;
+        packets += socks[s].packetsReceived;
+    }
+
+    double perClient = (welcomed > 0) ? 1.0 / welcomed / elapsed : 0.0;
+    printf("\nbots ran %.1f s: %d clients, %d welcomed, %d rejected\n",
+           elapsed, count, welcomed, rejected);
+    printf("states per client: %.1f/s (%.1f%% delta), stale %lld, dropped %lld, "
+           "ticks missed %lld\n",
+           states * perClient, (states > 0) ? 100.0 * deltas / states : 0.0,
+           stale, dropped, missed);
+    printf("received per client: %.0f B/s (%.0f on the wire)\n",
+           bytes * perClient, (bytes + packets * NET_UDP_OVERHEAD) * perClient);
+    printf("hash mismatches: %lld\n", mismatches);
+    if (predict)
+        PrintPrediction(predictors, count, elapsed);
+    fflush(stdout);
+
+    free(clients);
+    free(seeds);
+    free(socks);
+    free(predictors);
+    return (welcomed > 0 && mismatches == 0) ? 0 : 1;
+}
+
+static void PrintPrediction(const Predictor *predictors, int count, double elapsed)
+{
+    long long confirms = 0, corrections = 0, rollbacks = 0, resets = 0, resimulated = 0;
+    int deepest = 0;
+    for (int i = 0; i < count; i++)
+    {
+        confirms += predictors[i].confirms;
+        corrections += predictors[i].corrections;
+        rollbacks += predictors[i].rollbacks;
+        resets += predictors[i].resets;
+        resimulated += predictors[i].resimulated;
+        if (predictors[i].deepest > deepest)
+            deepest = predictors[i].deepest;
+    }
+    printf("prediction: %lld states checked, %.1f%% corrected, %.1f%% rolled back "
+           "(mean depth %.1f, deepest %d frames), %lld resets, "
+           "%.1f frames resimulated per client/s\n",
+           confirms, (confirms > 0) ? 100.0 * corrections / confirms : 0.0,
+           (confirms > 0) ? 100.0 * rollbacks / confirms : 0.0,
+           (rollbacks > 0) ? (double)resimulated / rollbacks : 0.0, deepest, resets,
+           (count > 0) ? resimulated / elapsed / count : 0.0);
+}
+
+// ---------------------------------------------------------------------
+//  RunLoopback
+// ---------------------------------------------------------------------
+static int RunLoopback(ServerConfig *config, int matches, double seconds, unsigned int seed,
+                       bool predict)
+{
+    config->maxMatches = matches;
+    int port = config->port;
+    int clients = matches * config->playersPerMatch;
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0)
+    {
+        perror("fork");
+        return 1;
+    }
+    if (child == 0)
+    {
+        // Let the server bind first; hellos are retried anyway
+        usleep(200000);
+        exit(RunBots("127.0.0.1", port, clients, seconds, seed, predict));
+    }
+
+    // A little longer than the bots, so their byes arrive
+    int result = RunServer(config, seconds + 0.5);
+    int status = 0;
+    if (result != 0)
+        kill(child, SIGTERM);
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        result = 1;
+    return result;
+}
+
+// ---------------------------------------------------------------------
+//  Tick timing helpers
+// ---------------------------------------------------------------------
+static bool AddTimes(TickTimes *times, double late, double work)
+{
+    if (times->count == times->capacity)
+    {
+        int capacity = (times->capacity > 0) ? times->capacity * 2 : 1024;
+        double *grownLate = realloc(times->late, sizeof(double) * (size_t)capacity);
+        if (grownLate == NULL)
+            return false;
+        times->late = grownLate;
+        double *grownWork = realloc(times->work, sizeof(double) * (size_t)capacity);
+        if (grownWork == NULL)
+            return false;
+        times->work = grownWork;
+        times->capacity = capacity;
+    }
+    times->late[times->count] = late;
+    times->work[times->count] = work;
+    times->count++;
+    return true;
+}
+
+static void PrintTimes(const char *label, double *values, int count)
+{
+    if (count == 0)
+        return;
+    qsort(values, (size_t)count, sizeof(double), CompareDouble);
+    printf("%s p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", label,
+           values[count / 2] * 1e6, values[(count * 90) / 100] * 1e6,
+           values[(count * 99) / 100] * 1e6, values[(int)(count * 0.999)] * 1e6,
+           values[count - 1] * 1e6);
+}
+
+static int CompareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,269 @@
+/*
+ * net.c
+ *
+ * Non-blocking UDP sockets with batched I/O (see net.h).
+ */
+
+#define _GNU_SOURCE // sendmmsg / recvmmsg
+
+#include "net.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+// Kernel buffer asked for on both directions: a server tick sends one
+// state per client in a burst, which the default ~200 KB cannot hold
+// for a thousand matches (the kernel caps it at net.core.*mem_max)
+#define NET_SOCKET_BUFFER (4 << 20)
+
+#define MAX_WAIT_SOCKETS 256
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static int SendBatch(NetSocket *sock, int first);
+static int ReceiveBatch(NetSocket *sock);
+
+// ---------------------------------------------------------------------
+//  Open / close
+// ---------------------------------------------------------------------
+bool NetOpen(NetSocket *sock, int port)
+{
+    memset(sock, 0, sizeof(NetSocket));
+    sock->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock->fd < 0)
+        return false;
+
+    int size = NET_SOCKET_BUFFER;
+    setsockopt(sock->fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(sock->fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((unsigned short)port);
+
+    int flags = fcntl(sock->fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(sock->fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+        bind(sock->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        close(sock->fd);
+        sock->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void NetClose(NetSocket *sock)
+{
+    if (sock->fd >= 0)
+    {
+        NetFlush(sock);
+        close(sock->fd);
+    }
+    sock->fd = -1;
+}
+
+bool NetResolve(const char *host, int port, struct sockaddr_in *addr)
+{
+    memset(addr, 0, sizeof(struct sockaddr_in));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, host, &addr->sin_addr) == 1)
+        return true;
+
+    struct addrinfo hints, *found = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, NULL, &hints, &found) != 0 || found == NULL)
+        return false;
+
+    addr->sin_addr = ((struct sockaddr_in *)found->ai_addr)->sin_addr;
+    freeaddrinfo(found);
+    return true;
+}
+
+// ---------------------------------------------------------------------
+//  Send
+// ---------------------------------------------------------------------
+void NetSend(NetSocket *sock, const struct sockaddr_in *to,
+             const unsigned char *data, size_t length)
+{
+    if (length > NET_MAX_PACKET)
+        return;
+    if (sock->outCount == NET_BATCH)
+        NetFlush(sock);
+
+    int i = sock->outCount++;
+    memcpy(sock->out[i], data, length);
+    sock->outLength[i] = length;
+    sock->outAddr[i] = *to;
+}
+
+void NetFlush(NetSocket *sock)
+{
+    int first = 0;
+    while (first < sock->outCount)
+    {
+        int sent = SendBatch(sock, first);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // Buffer full or unreachable: UDP may drop, so does this
+            sock->sendErrors++;
+            first++;
+            continue;
+        }
+
+        for (int i = first; i < first + sent; i++)
+            sock->bytesSent += (long long)sock->outLength[i];
+        sock->packetsSent += sent;
+        first += sent;
+    }
+    sock->outCount = 0;
+}
+
+#ifdef __linux__
+static int SendBatch(NetSocket *sock, int first)
+{
+    struct mmsghdr msgs[NET_BATCH];
+    struct iovec iov[NET_BATCH];
+    int count = sock->outCount - first;
+    memset(msgs, 0, sizeof(struct mmsghdr) * (size_t)count);
+    for (int i = 0; i < count; i++)
+    {
+        iov[i].iov_base = sock->out[first + i];
+        iov[i].iov_len = sock->outLength[first + i];
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &sock->outAddr[first + i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+    return sendmmsg(sock->fd, msgs, (unsigned int)count, 0);
+}
+#else
+static int SendBatch(NetSocket *sock, int first)
+{
+    ssize_t sent = sendto(sock->fd, sock->out[first], sock->outLength[first], 0,
+                          (const struct sockaddr *)&sock->outAddr[first],
+                          sizeof(struct sockaddr_in));
+    return (sent < 0) ? -1 : 1;
+}
+#endif
+
+// ---------------------------------------------------------------------
+//  Receive
+// ---------------------------------------------------------------------
+bool NetReceive(NetSocket *sock, struct sockaddr_in *from,
+                const unsigned char **data, size_t *length)
+{
+    if (sock->inNext == sock->inCount)
+    {
+        sock->inNext = 0;
+        sock->inCount = 0;
+        int received;
+        do
+            received = ReceiveBatch(sock);
+        while (received < 0 && errno == EINTR);
+        if (received <= 0)
+            return false;
+
+        sock->inCount = received;
+        sock->packetsReceived += received;
+        for (int i = 0; i < received; i++)
+            sock->bytesReceived += (long long)sock->inLength[i];
+    }
+
+    int i = sock->inNext++;
+    *from = sock->inAddr[i];
+    *data = sock->in[i];
+    *length = sock->inLength[i];
+    return true;
+}
+
+#ifdef __linux__
+static int ReceiveBatch(NetSocket *sock)
+{
+    struct mmsghdr msgs[NET_BATCH];
+    struct iovec iov[NET_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < NET_BATCH; i++)
+    {
+        iov[i].iov_base = sock->in[i];
+        iov[i].iov_len = NET_MAX_PACKET;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &sock->inAddr[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+
+    int received = recvmmsg(sock->fd, msgs, NET_BATCH, MSG_DONTWAIT, NULL);
+    for (int i = 0; i < received; i++)
+        sock->inLength[i] = msgs[i].msg_len;
+    return received;
+}
+#else
+static int ReceiveBatch(NetSocket *sock)
+{
+    socklen_t addrLength = sizeof(struct sockaddr_in);
+    ssize_t received = recvfrom(sock->fd, sock->in[0], NET_MAX_PACKET, 0,
+                                (struct sockaddr *)&sock->inAddr[0], &addrLength);
+    if (received < 0)
+        return -1;
+    sock->inLength[0] = (size_t)received;
+    return 1;
+}
+#endif
+
+bool NetWait(NetSocket *const *socks, int count, double seconds)
+{
+    if (count > MAX_WAIT_SOCKETS)
+        count = MAX_WAIT_SOCKETS;
+
+    // Datagrams left over from the last batch count as waiting
+    struct pollfd fds[MAX_WAIT_SOCKETS];
+    for (int i = 0; i < count; i++)
+    {
+        if (socks[i]->inNext < socks[i]->inCount)
+            return true;
+        fds[i].fd = socks[i]->fd;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+
+    if (seconds < 0.0)
+        seconds = 0.0;
+#ifdef __linux__
+    // Nanosecond timeout: a tick loop waiting on poll's milliseconds
+    // would start every tick up to half a millisecond off
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)seconds;
+    timeout.tv_nsec = (long)((seconds - (double)timeout.tv_sec) * 1e9);
+    return ppoll(fds, (nfds_t)count, &timeout, NULL) > 0;
+#else
+    return poll(fds, (nfds_t)count, (int)(seconds * 1000.0)) > 0;
+#endif
+}
+
+// ---------------------------------------------------------------------
+//  NetNow
+// ---------------------------------------------------------------------
+double NetNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
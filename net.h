@@ -0,0 +1,166 @@
+/*
+ * net.h
+ *
+ * UDP plumbing shared by the authoritative match server (server.c) and
+ * its clients (netclient.c): non-blocking sockets with batched send and
+ * receive (sendmmsg / recvmmsg on Linux, one call per packet
+ * elsewhere), the packet layouts and a monotonic clock. POSIX only.
+ *
+ * Packets (integers little endian, the first byte is the type):
+ *    NET_HELLO    C->S  u8 version, u32 nonce
+ *    NET_WELCOME  S->C  u32 nonce, u32 token, u16 player, u16 players,
+ *                       u16 tickRate, u16 map width, u16 map height
+ *    NET_REJECT   S->C  u32 nonce
+ *    NET_INPUT    C->S  u32 token, u32 sequence, u32 ack, u8 keys
+ *    NET_STATE    S->C  u32 nonce, u32 tick, u32 base, u64 hash,
+ *                       u32 applied, u8 keys per player,
+ *                       snapshot (snapshot.h)
+ *    NET_BYE      C->S  u32 token
+ *
+ * The nonce is picked by the client and echoed in everything the server
+ * sends it, so many clients can share one socket. The token names the
+ * client's seat on the server. `ack` is the last tick the client has
+ * decoded; the server encodes the next state as a delta against it
+ * while it is recent enough (base = that tick), else as a full
+ * snapshot (base = NET_NO_TICK).
+ *
+ * `applied` is the sequence of the newest input from this client the
+ * server had when it stepped the tick (0 before any), and the keys are
+ * the input every player's ship got that tick, so a predicting client
+ * (prediction.h) knows which of its frames the state confirms and what
+ * the others were doing.
+ */
+
+#ifndef NET_H
+#define NET_H
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define NET_VERSION 2
+#define NET_DEFAULT_PORT 27960
+
+#define NET_HELLO 1
+#define NET_WELCOME 2
+#define NET_REJECT 3
+#define NET_INPUT 4
+#define NET_STATE 5
+#define NET_BYE 6
+
+#define NET_HELLO_BYTES 6
+#define NET_WELCOME_BYTES 19
+#define NET_REJECT_BYTES 5
+#define NET_INPUT_BYTES 14
+#define NET_STATE_HEADER 25 // Then the keys, then the snapshot
+#define NET_BYE_BYTES 5
+
+#define NET_NO_TICK 0xFFFFFFFFu // ack / base meaning "none"
+
+// Largest datagram either side sends: below the usual 1280 byte IPv6
+// minimum MTU, so a state never gets fragmented
+#define NET_MAX_PACKET 1200
+
+// States kept per match (server) and per client, i.e. how old a tick
+// may be and still serve as a delta base (NET_HISTORY / tickRate s)
+#define NET_HISTORY 16
+
+#define NET_BATCH 64 // Datagrams per sendmmsg / recvmmsg call
+
+// Bytes of IPv4 + UDP header per datagram, for wire-level bandwidth
+#define NET_UDP_OVERHEAD 28
+
+typedef struct
+{
+    int fd;
+
+    // Queued by NetSend, written by NetFlush (or when the queue fills)
+    unsigned char out[NET_BATCH][NET_MAX_PACKET];
+    size_t outLength[NET_BATCH];
+    struct sockaddr_in outAddr[NET_BATCH];
+    int outCount;
+
+    // Last recvmmsg batch, handed out one by one by NetReceive
+    unsigned char in[NET_BATCH][NET_MAX_PACKET];
+    size_t inLength[NET_BATCH];
+    struct sockaddr_in inAddr[NET_BATCH];
+    int inCount, inNext;
+
+    long long packetsSent, bytesSent;
+    long long packetsReceived, bytesReceived;
+    long long sendErrors; // Datagrams the kernel refused (buffer full)
+} NetSocket;
+
+// Open a non-blocking UDP socket bound to `port` on every interface
+// (0 = any free port, for clients). Returns false on failure.
+bool NetOpen(NetSocket *sock, int port);
+void NetClose(NetSocket *sock);
+
+// Host name or dotted address plus port to an IPv4 address
+bool NetResolve(const char *host, int port, struct sockaddr_in *addr);
+
+// Queue one datagram of at most NET_MAX_PACKET bytes
+void NetSend(NetSocket *sock, const struct sockaddr_in *to,
+             const unsigned char *data, size_t length);
+void NetFlush(NetSocket *sock);
+
+// Next received datagram, or false when none is waiting. *data stays
+// valid until the next call.
+bool NetReceive(NetSocket *sock, struct sockaddr_in *from,
+                const unsigned char **data, size_t *length);
+
+// Block until a datagram is waiting on any of `count` sockets or
+// `seconds` pass. Returns false on timeout.
+bool NetWait(NetSocket *const *socks, int count, double seconds);
+
+// Monotonic time in seconds
+double NetNow(void);
+
+static inline bool NetSameAddress(const struct sockaddr_in *a, const struct sockaddr_in *b)
+{
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+// ---------------------------------------------------------------------
+//  Byte order helpers
+// ---------------------------------------------------------------------
+static inline void NetPutU16(unsigned char *p, unsigned int value)
+{
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+static inline void NetPutU32(unsigned char *p, unsigned int value)
+{
+    for (int b = 0; b < 4; b++)
+        p[b] = (unsigned char)(value >> (b * 8));
+}
+
+static inline void NetPutU64(unsigned char *p, unsigned long long value)
+{
+    for (int b = 0; b < 8; b++)
+        p[b] = (unsigned char)(value >> (b * 8));
+}
+
+static inline unsigned int NetGetU16(const unsigned char *p)
+{
+    return p[0] | ((unsigned int)p[1] << 8);
+}
+
+static inline unsigned int NetGetU32(const unsigned char *p)
+{
+    unsigned int value = 0;
+    for (int b = 0; b < 4; b++)
+        value |= (unsigned int)p[b] << (b * 8);
+    return value;
+}
+
+static inline unsigned long long NetGetU64(const unsigned char *p)
+{
+    unsigned long long value = 0;
+    for (int b = 0; b < 8; b++)
+        value |= (unsigned long long)p[b] << (b * 8);
+    return value;
+}
+
+#endif // NET_H
@@ -0,0 +1,187 @@
+/*
+ * netclient.c
+ *
+ * Client side of the match server protocol (see netclient.h).
+ */
+
+#include "netclient.h"
+
+#include <string.h>
+
+#include "snapshot.h"
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void HandleWelcome(NetClient *client, const unsigned char *data);
+static bool HandleState(NetClient *client, const unsigned char *data, size_t length);
+
+// ---------------------------------------------------------------------
+//  Init / free
+// ---------------------------------------------------------------------
+void NetClientInit(NetClient *client, unsigned int nonce)
+{
+    memset(client, 0, sizeof(NetClient));
+    client->nonce = nonce;
+    client->latest = NET_NO_TICK;
+    for (int h = 0; h < NET_HISTORY; h++)
+        client->historyTick[h] = NET_NO_TICK;
+}
+
+void NetClientFree(NetClient *client)
+{
+    MapFree(client->map);
+    client->map = NULL;
+}
+
+// ---------------------------------------------------------------------
+//  Packet builders
+// ---------------------------------------------------------------------
+size_t NetClientHello(const NetClient *client, unsigned char *buf)
+{
+    buf[0] = NET_HELLO;
+    buf[1] = NET_VERSION;
+    NetPutU32(buf + 2, client->nonce);
+    return NET_HELLO_BYTES;
+}
+
+size_t NetClientInput(NetClient *client, unsigned char keys, unsigned char *buf)
+{
+    if (!client->welcomed)
+        return 0;
+
+    buf[0] = NET_INPUT;
+    NetPutU32(buf + 1, client->token);
+    NetPutU32(buf + 5, ++client->sequence);
+    NetPutU32(buf + 9, client->latest);
+    buf[13] = keys;
+    return NET_INPUT_BYTES;
+}
+
+size_t NetClientBye(const NetClient *client, unsigned char *buf)
+{
+    buf[0] = NET_BYE;
+    NetPutU32(buf + 1, client->token);
+    return NET_BYE_BYTES;
+}
+
+// ---------------------------------------------------------------------
+//  NetClientHandle
+// ---------------------------------------------------------------------
+bool NetClientHandle(NetClient *client, const unsigned char *data, size_t length)
+{
+    unsigned int nonce;
+    if (!NetPacketNonce(data, length, &nonce) || nonce != client->nonce)
+        return false;
+
+    switch (data[0])
+    {
+    case NET_WELCOME:
+        if (length == NET_WELCOME_BYTES && !client->welcomed)
+            HandleWelcome(client, data);
+        return false;
+
+    case NET_REJECT:
+        if (length == NET_REJECT_BYTES && !client->welcomed)
+            client->rejected = true;
+        return false;
+
+    case NET_STATE:
+        return client->welcomed && length > NET_STATE_HEADER &&
+               HandleState(client, data, length);
+
+    default:
+        return false;
+    }
+}
+
+static void HandleWelcome(NetClient *client, const unsigned char *data)
+{
+    int players = (int)NetGetU16(data + 11);
+    GameMap *map = MapCreate((int)NetGetU16(data + 15), (int)NetGetU16(data + 17));
+    int player = (int)NetGetU16(data + 9);
+    if (map == NULL || players < 2 || players > MAX_PLAYERS || player >= players)
+    {
+        MapFree(map);
+        client->rejected = true;
+        return;
+    }
+
+    client->welcomed = true;
+    client->token = NetGetU32(data + 5);
+    client->player = player;
+    client->playerCount = players;
+    client->tickRate = (int)NetGetU16(data + 13);
+    client->map = map;
+    InitGame(&client->setup, map, players);
+    // Every slot holds the match setup, so any of them decodes
+    for (int h = 0; h < NET_HISTORY; h++)
+        client->history[h] = client->setup;
+}
+
+static bool HandleState(NetClient *client, const unsigned char *data, size_t length)
+{
+    unsigned int tick = NetGetU32(data + 5);
+    unsigned int base = NetGetU32(data + 9);
+    unsigned long long hash = NetGetU64(data + 13);
+    size_t keysEnd = NET_STATE_HEADER + (size_t)client->playerCount;
+    client->statesReceived++;
+
+    if (client->latest != NET_NO_TICK && (int)(tick - client->latest) <= 0)
+    {
+        client->statesStale++;
+        return false;
+    }
+
+    const GameState *from = NULL;
+    if (base != NET_NO_TICK)
+    {
+        from = &client->history[base % NET_HISTORY];
+        if (client->historyTick[base % NET_HISTORY] != base || tick - base >= NET_HISTORY)
+        {
+            client->statesDropped++;
+            return false;
+        }
+        client->deltaStates++;
+    }
+
+    int slot = (int)(tick % NET_HISTORY);
+    GameState *game = &client->history[slot];
+    if (from == NULL)
+        CopyGameState(game, &client->setup);
+    // A state that decodes to the wrong hash would poison every delta
+    // built on it, so it is dropped like one that does not decode
+    bool decoded = length > keysEnd &&
+                   SnapshotDecode(data + keysEnd, length - keysEnd, from, game);
+    if (decoded && HashGameState(game) != hash)
+    {
+        client->hashMismatches++;
+        decoded = false;
+    }
+    if (!decoded)
+    {
+        CopyGameState(game, &client->setup);
+        client->historyTick[slot] = NET_NO_TICK;
+        client->statesDropped++;
+        return false;
+    }
+
+    if (client->latest != NET_NO_TICK)
+        client->ticksMissed += tick - client->latest - 1;
+    client->historyTick[slot] = tick;
+    client->latest = tick;
+    client->applied = NetGetU32(data + 21);
+    memset(&client->used, 0, sizeof(InputFrame));
+    memcpy(client->used.keys, data + NET_STATE_HEADER, (size_t)client->playerCount);
+    return true;
+}
+
+// ---------------------------------------------------------------------
+//  NetClientState
+// ---------------------------------------------------------------------
+const GameState *NetClientState(const NetClient *client)
+{
+    if (client->latest == NET_NO_TICK)
+        return NULL;
+    return &client->history[client->latest % NET_HISTORY];
+}
@@ -0,0 +1,74 @@
+/*
+ * netclient.h
+ *
+ * Client side of the match server protocol (net.h). A NetClient only
+ * builds outgoing packets and digests incoming ones, it owns no socket,
+ * so one process can run many clients over a few sockets (load tests)
+ * and the caller decides when to send.
+ *
+ * Every state received is decoded (full, or delta against a tick kept
+ * in the client's own history) and checked against the server's hash,
+ * and the newest tick decoded is acknowledged with the next input.
+ */
+
+#ifndef NETCLIENT_H
+#define NETCLIENT_H
+
+#include <stddef.h>
+
+#include "net.h"
+#include "simulation.h"
+
+typedef struct
+{
+    unsigned int nonce;
+    unsigned int token;
+    bool welcomed, rejected;
+    int player, playerCount;
+    int tickRate;
+    GameMap *map;         // Rebuilt from the size in the welcome
+    GameState setup;      // InitGame of the match, for full snapshots
+
+    // State of tick t in history[t % NET_HISTORY], if historyTick says so
+    GameState history[NET_HISTORY];
+    unsigned int historyTick[NET_HISTORY];
+    unsigned int latest;   // Newest tick decoded, NET_NO_TICK before any
+    unsigned int sequence; // Of the last input sent
+    unsigned int applied;  // Newest own input the latest tick stepped with
+    InputFrame used;       // Input every ship got on the latest tick
+
+    long long statesReceived, deltaStates;
+    long long statesStale;     // Older than one already decoded
+    long long statesDropped;   // Base tick no longer kept, or corrupt
+    long long hashMismatches;  // Decoded state differs from the server's (dropped)
+    long long ticksMissed;     // Ticks skipped between decoded states
+} NetClient;
+
+// `nonce` tells this client apart from others sharing its socket
+void NetClientInit(NetClient *client, unsigned int nonce);
+void NetClientFree(NetClient *client);
+
+// Packet builders: write into `buf` (NET_MAX_PACKET bytes), return the
+// length. Input can only be sent once welcomed.
+size_t NetClientHello(const NetClient *client, unsigned char *buf);
+size_t NetClientInput(NetClient *client, unsigned char keys, unsigned char *buf);
+size_t NetClientBye(const NetClient *client, unsigned char *buf);
+
+// Digest one packet from the server. Returns true when it brought a
+// newer state.
+bool NetClientHandle(NetClient *client, const unsigned char *data, size_t length);
+
+// Newest decoded state, NULL before the first
+const GameState *NetClientState(const NetClient *client);
+
+// Nonce of a packet from the server (any type), false if too short
+static inline bool NetPacketNonce(const unsigned char *data, size_t length,
+                                  unsigned int *nonce)
+{
+    if (length < 5)
+        return false;
+    *nonce = NetGetU32(data + 1);
+    return true;
+}
+
+#endif // NETCLIENT_H
@@ -0,0 +1,264 @@
+/*
+ * paths.c
+ *
+ * All-targets breadth-first distance fields (see paths.h).
+ */
+
+#include "paths.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+#define PATH_UNREACHABLE 0xFFFF
+#define PATH_DIRECTIONS 8
+
+// Straight moves first, so routes only turn diagonal when it is shorter
+static const int stepX[PATH_DIRECTIONS] = {0, 0, -1, 1, -1, 1, -1, 1};
+static const int stepY[PATH_DIRECTIONS] = {-1, 1, 0, 0, -1, -1, 1, 1};
+static const unsigned char stepKeys[PATH_DIRECTIONS] = {
+    INPUT_UP, INPUT_DOWN, INPUT_LEFT, INPUT_RIGHT,
+    INPUT_UP | INPUT_LEFT, INPUT_UP | INPUT_RIGHT,
+    INPUT_DOWN | INPUT_LEFT, INPUT_DOWN | INPUT_RIGHT};
+
+// ---------------------------------------------------------------------
+//  Structs
+// ---------------------------------------------------------------------
+struct PathTable
+{
+    const GameMap *map;
+    unsigned int revision; // Of the map the fields were built from
+    size_t maxBytes;
+    size_t bytes;
+
+    int openCells;
+    int *cellIndex;           // Per map cell: its open cell, or -1 if solid
+    int *neighbors;           // PATH_DIRECTIONS per open cell, -1 if solid
+    unsigned short *distance; // openCells rows (one per target) of openCells
+};
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static bool Build(PathTable *paths);
+static void Release(PathTable *paths);
+static void Search(PathTable *paths, int target, int *queue);
+static int OpenCell(const PathTable *paths, int x, int y);
+static int CountOpen(const GameMap *map);
+
+// ---------------------------------------------------------------------
+//  PathsCreate / PathsDestroy / PathsRefresh
+// ---------------------------------------------------------------------
+PathTable *PathsCreate(const GameMap *map, size_t maxBytes)
+{
+    PathTable *paths = calloc(1, sizeof(PathTable));
+    if (paths == NULL)
+        return NULL;
+
+    paths->map = map;
+    paths->maxBytes = maxBytes;
+    if (!Build(paths))
+    {
+        PathsDestroy(paths);
+        return NULL;
+    }
+    return paths;
+}
+
+void PathsDestroy(PathTable *paths)
+{
+    if (paths == NULL)
+        return;
+    Release(paths);
+    free(paths);
+}
+
+bool PathsRefresh(PathTable *paths)
+{
+    if (paths->distance != NULL && paths->revision == paths->map->revision)
+        return true;
+    return Build(paths);
+}
+
+// ---------------------------------------------------------------------
+//  Build
+//    One search per open cell over a neighbour list made up front, so
+//    the searches never test the bitboard
+// ---------------------------------------------------------------------
+static bool Build(PathTable *paths)
+{
+    const GameMap *map = paths->map;
+    Release(paths);
+    paths->revision = map->revision;
+
+    size_t bytes = PathsBytesFor(map);
+    if (paths->maxBytes > 0 && bytes > paths->maxBytes)
+        return false;
+
+    int open = CountOpen(map);
+    if (open >= PATH_UNREACHABLE)
+        return false; // A route could be too long for a distance
+
+    size_t cells = (size_t)map->width * (size_t)map->height;
+    paths->cellIndex = malloc(sizeof(int) * cells);
+    paths->neighbors = malloc(sizeof(int) * PATH_DIRECTIONS * (size_t)(open > 0 ? open : 1));
+    paths->distance = malloc(sizeof(unsigned short) * (size_t)open * (size_t)open + 1);
+    int *queue = malloc(sizeof(int) * (size_t)(open > 0 ? open : 1));
+    if (paths->cellIndex == NULL || paths->neighbors == NULL ||
+        paths->distance == NULL || queue == NULL)
+    {
+        free(queue);
+        Release(paths);
+        return false;
+    }
+
+    int next = 0;
+    for (int y = 0; y < map->height; y++)
+        for (int x = 0; x < map->width; x++)
+            paths->cellIndex[(size_t)y * map->width + x] = SolidAt(map, x, y) ? -1 : next++;
+    paths->openCells = open;
+
+    // The bitboard's solid frame keeps every neighbour test in bounds
+    for (int y = 0; y < map->height; y++)
+    {
+        for (int x = 0; x < map->width; x++)
+        {
+            int cell = paths->cellIndex[(size_t)y * map->width + x];
+            if (cell < 0)
+                continue;
+            int *around = paths->neighbors + (size_t)cell * PATH_DIRECTIONS;
+            for (int d = 0; d < PATH_DIRECTIONS; d++)
+            {
+                int nx = x + stepX[d];
+                int ny = y + stepY[d];
+                around[d] = SolidAt(map, nx, ny)
+                                ? -1
+                                : paths->cellIndex[(size_t)ny * map->width + nx];
+            }
+        }
+    }
+
+    for (int target = 0; target < open; target++)
+        Search(paths, target, queue);
+
+    free(queue);
+    paths->bytes = bytes;
+    return true;
+}
+
+// Fills the target's row: every open cell's distance to it
+static void Search(PathTable *paths, int target, int *queue)
+{
+    int open = paths->openCells;
+    unsigned short *row = paths->distance + (size_t)target * (size_t)open;
+    memset(row, 0xFF, sizeof(unsigned short) * (size_t)open);
+
+    int head = 0;
+    int tail = 0;
+    row[target] = 0;
+    queue[tail++] = target;
+    while (head < tail)
+    {
+        int cell = queue[head++];
+        unsigned short step = (unsigned short)(row[cell] + 1);
+        const int *around = paths->neighbors + (size_t)cell * PATH_DIRECTIONS;
+        for (int d = 0; d < PATH_DIRECTIONS; d++)
+        {
+            int neighbor = around[d];
+            if (neighbor >= 0 && row[neighbor] == PATH_UNREACHABLE)
+            {
+                row[neighbor] = step;
+                queue[tail++] = neighbor;
+            }
+        }
+    }
+}
+
+static void Release(PathTable *paths)
+{
+    free(paths->distance);
+    free(paths->neighbors);
+    free(paths->cellIndex);
+    paths->distance = NULL;
+    paths->neighbors = NULL;
+    paths->cellIndex = NULL;
+    paths->openCells = 0;
+    paths->bytes = 0;
+}
+
+// ---------------------------------------------------------------------
+//  Lookups
+// ---------------------------------------------------------------------
+int PathDistance(const PathTable *paths, int fromX, int fromY, int toX, int toY)
+{
+    int from = OpenCell(paths, fromX, fromY);
+    int to = OpenCell(paths, toX, toY);
+    if (from < 0 || to < 0)
+        return -1;
+
+    unsigned short distance = paths->distance[(size_t)to * paths->openCells + from];
+    return (distance == PATH_UNREACHABLE) ? -1 : distance;
+}
+
+// The neighbour one tick closer to the target, looked up in the
+// target's row
+unsigned char PathNextKeys(const PathTable *paths, int fromX, int fromY, int toX, int toY)
+{
+    int from = OpenCell(paths, fromX, fromY);
+    int to = OpenCell(paths, toX, toY);
+    if (from < 0 || to < 0)
+        return 0;
+
+    const unsigned short *row = paths->distance + (size_t)to * paths->openCells;
+    unsigned short distance = row[from];
+    if (distance == 0 || distance == PATH_UNREACHABLE)
+        return 0;
+
+    const int *around = paths->neighbors + (size_t)from * PATH_DIRECTIONS;
+    for (int d = 0; d < PATH_DIRECTIONS; d++)
+    {
+        if (around[d] >= 0 && row[around[d]] == distance - 1)
+            return stepKeys[d];
+    }
+    return 0;
+}
+
+static int OpenCell(const PathTable *paths, int x, int y)
+{
+    const GameMap *map = paths->map;
+    if (paths->distance == NULL || x < 0 || y < 0 || x >= map->width || y >= map->height)
+        return -1;
+    return paths->cellIndex[(size_t)y * map->width + x];
+}
+
+// ---------------------------------------------------------------------
+//  Sizes
+// ---------------------------------------------------------------------
+size_t PathsBytes(const PathTable *paths)
+{
+    return paths->bytes;
+}
+
+size_t PathsBytesFor(const GameMap *map)
+{
+    size_t open = (size_t)CountOpen(map);
+    size_t cells = (size_t)map->width * (size_t)map->height;
+    return sizeof(unsigned short) * open * open +
+           sizeof(int) * (cells + PATH_DIRECTIONS * open);
+}
+
+int PathsOpenCells(const PathTable *paths)
+{
+    return paths->openCells;
+}
+
+static int CountOpen(const GameMap *map)
+{
+    int open = 0;
+    for (int y = 0; y < map->height; y++)
+        for (int x = 0; x < map->width; x++)
+            open += !SolidAt(map, x, y);
+    return open;
+}
@@ -0,0 +1,57 @@
+/*
+ * paths.h
+ *
+ * Distance fields for steering around the '#' boundary and 'X' rocks:
+ * a breadth-first search from every open cell of a map, done once, so
+ * a bot asks "how far is it from here to there" and "which way is the
+ * first step" for any pair of cells with a table lookup.
+ *
+ * Ships move one cell a tick in any of 8 directions, onto any open
+ * cell (diagonals may pass between two rocks, as UpdateShips allows),
+ * so a distance is the number of ticks the route takes. Moves are
+ * reversible, which makes one field per target cell serve as the
+ * distance from every cell to it.
+ *
+ * The table holds openCells^2 distances of 2 bytes, row by target, so
+ * it is meant for the bays matches are played in (20x10: 40 KB; 64x64:
+ * 28 MB) and is refused past a memory cap. It is built for the
+ * map's current revision; PathsRefresh rebuilds it only after the map
+ * was edited (BuildSolidMap).
+ */
+
+#ifndef PATHS_H
+#define PATHS_H
+
+#include <stddef.h>
+
+#include "simulation.h"
+
+typedef struct PathTable PathTable;
+
+// Builds the fields for `map`, which must outlive the table. Returns
+// NULL if they would take more than maxBytes (0 = no cap) or memory
+// runs out.
+PathTable *PathsCreate(const GameMap *map, size_t maxBytes);
+void PathsDestroy(PathTable *paths);
+
+// Rebuild if the map changed since the last build. Returns false if
+// the new fields do not fit, in which case every lookup answers "no
+// route" until a refresh succeeds.
+bool PathsRefresh(PathTable *paths);
+
+// Ticks from (fromX, fromY) to (toX, toY), or -1 if either cell is
+// solid or outside the map or no route joins them
+int PathDistance(const PathTable *paths, int fromX, int fromY, int toX, int toY);
+
+// The keys (INPUT_* movement bits) of the first step of a shortest
+// route, straight moves preferred over diagonals; 0 when already there
+// or there is no route
+unsigned char PathNextKeys(const PathTable *paths, int fromX, int fromY, int toX, int toY);
+
+// Bytes the table holds, and what a build for `map` would take
+size_t PathsBytes(const PathTable *paths);
+size_t PathsBytesFor(const GameMap *map);
+
+int PathsOpenCells(const PathTable *paths);
+
+#endif // PATHS_H
@@ -0,0 +1,127 @@
+/*
+ * prediction.c
+ *
+ * Client-side prediction with rollback (see prediction.h).
+ */
+
+#include "prediction.h"
+
+#include <string.h>
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void PredictFrame(Predictor *predictor, unsigned int frame);
+static int Resimulate(Predictor *predictor, const GameState *authoritative,
+                      unsigned int frame);
+
+// ---------------------------------------------------------------------
+//  PredictorInit
+// ---------------------------------------------------------------------
+void PredictorInit(Predictor *predictor, int player)
+{
+    memset(predictor, 0, sizeof(Predictor));
+    predictor->player = player;
+}
+
+// ---------------------------------------------------------------------
+//  PredictorStep
+// ---------------------------------------------------------------------
+const GameState *PredictorStep(Predictor *predictor, unsigned int sequence,
+                               unsigned char keys)
+{
+    predictor->keys[sequence % PREDICT_HISTORY] = keys;
+    predictor->frame = sequence;
+    if (!predictor->started)
+        return NULL;
+
+    PredictFrame(predictor, sequence);
+    return &predictor->states[sequence % PREDICT_HISTORY];
+}
+
+static void PredictFrame(Predictor *predictor, unsigned int frame)
+{
+    const GameState *previous = &predictor->states[(frame - 1) % PREDICT_HISTORY];
+    GameState *next = &predictor->states[frame % PREDICT_HISTORY];
+
+    InputFrame input = predictor->others;
+    input.keys[predictor->player] = predictor->keys[frame % PREDICT_HISTORY];
+    CopyGameState(next, previous);
+    SimStep(next, &input);
+}
+
+// ---------------------------------------------------------------------
+//  PredictorConfirm
+// ---------------------------------------------------------------------
+int PredictorConfirm(Predictor *predictor, const GameState *authoritative,
+                     unsigned int applied, const InputFrame *used)
+{
+    predictor->confirms++;
+    for (int i = 0; i < authoritative->playerCount; i++)
+        predictor->others.keys[i] = used->keys[i] & (unsigned char)~INPUT_FIRE;
+    predictor->others.keys[predictor->player] = 0;
+
+    // The first state anchors the ring, and one older than the ring (or
+    // claiming an input not sent yet) replaces the newest frame as is
+    unsigned int behind = predictor->frame - applied;
+    if (!predictor->started || behind >= PREDICT_HISTORY)
+    {
+        if (predictor->started)
+            predictor->resets++;
+        predictor->started = true;
+        if (behind >= PREDICT_HISTORY)
+            return Resimulate(predictor, authoritative, predictor->frame);
+        return Resimulate(predictor, authoritative, applied);
+    }
+
+    const GameState *predicted = &predictor->states[applied % PREDICT_HISTORY];
+    if (HashGameState(predicted) == HashGameState(authoritative))
+    {
+        predictor->confirmed = applied;
+        return 0;
+    }
+    return PredictorRollback(predictor, authoritative, applied);
+}
+
+// ---------------------------------------------------------------------
+//  PredictorRollback
+// ---------------------------------------------------------------------
+int PredictorRollback(Predictor *predictor, const GameState *authoritative,
+                      unsigned int frame)
+{
+    if (predictor->frame - frame >= PREDICT_HISTORY)
+        frame = predictor->frame;
+
+    // A mismatch on the newest frame is corrected in place; only one
+    // with frames after it to simulate again is a rollback
+    int depth = Resimulate(predictor, authoritative, frame);
+    predictor->corrections++;
+    if (depth > 0)
+        predictor->rollbacks++;
+    predictor->resimulated += depth;
+    if (depth > predictor->deepest)
+        predictor->deepest = depth;
+    return depth;
+}
+
+static int Resimulate(Predictor *predictor, const GameState *authoritative,
+                      unsigned int frame)
+{
+    CopyGameState(&predictor->states[frame % PREDICT_HISTORY], authoritative);
+    predictor->confirmed = frame;
+
+    int depth = (int)(predictor->frame - frame);
+    for (int d = 1; d <= depth; d++)
+        PredictFrame(predictor, frame + (unsigned int)d);
+    return depth;
+}
+
+// ---------------------------------------------------------------------
+//  PredictorState
+// ---------------------------------------------------------------------
+const GameState *PredictorState(const Predictor *predictor)
+{
+    if (!predictor->started)
+        return NULL;
+    return &predictor->states[predictor->frame % PREDICT_HISTORY];
+}
@@ -0,0 +1,70 @@
+/*
+ * prediction.h
+ *
+ * Client-side prediction with rollback, on top of netclient.h. The
+ * client steps its own copy of the match every frame with the keys it
+ * just sent, instead of waiting a round trip for the server, and keeps
+ * the predicted state of each recent frame in a ring.
+ *
+ * Frame s is the state after the client's input with sequence s. Each
+ * authoritative state says which of the client's inputs the server had
+ * applied when it produced it (`applied`), so it is the truth for that
+ * frame: if the prediction kept for it differs, the ring is rolled back
+ * to the server's state and every later frame is simulated again with
+ * the same own keys. The other players are predicted to hold the
+ * movement keys the server last used for them, without firing.
+ */
+
+#ifndef PREDICTION_H
+#define PREDICTION_H
+
+#include "simulation.h"
+
+// Frames of prediction kept, i.e. the deepest rollback (about one
+// second at 60 Hz). An authoritative state older than that resets
+// the prediction to it.
+#define PREDICT_HISTORY 64
+
+typedef struct
+{
+    int player;            // The local player's ship
+    bool started;          // An authoritative state has anchored the ring
+    unsigned int frame;    // Newest frame predicted (sequence of the last input)
+    unsigned int confirmed;// Frame of the newest authoritative state
+
+    // Frame s in [s % PREDICT_HISTORY]
+    GameState states[PREDICT_HISTORY];
+    unsigned char keys[PREDICT_HISTORY]; // Own keys of frame s
+    InputFrame others;     // Guess for the other players
+
+    long long confirms;    // Authoritative states checked
+    long long corrections; // ... that differed from the prediction
+    long long rollbacks;   // ... of those, with frames to simulate again
+    long long resets;      // ... too old to roll back to
+    long long resimulated; // Frames simulated again by rollbacks
+    int deepest;           // Longest rollback, in frames
+} Predictor;
+
+void PredictorInit(Predictor *predictor, int player);
+
+// Predict frame `sequence` (the previous frame + 1) with the local
+// keys of that input. Returns the new state, or NULL until the first
+// authoritative state arrived (the keys are kept for it).
+const GameState *PredictorStep(Predictor *predictor, unsigned int sequence,
+                               unsigned char keys);
+
+// Check an authoritative state, the truth for frame `applied`, against
+// the prediction and roll back if they differ. `used` is the input the
+// server stepped with. Returns the frames simulated again.
+int PredictorConfirm(Predictor *predictor, const GameState *authoritative,
+                     unsigned int applied, const InputFrame *used);
+
+// Replace frame `frame` with `authoritative` and simulate every frame
+// after it again. Returns the frames simulated.
+int PredictorRollback(Predictor *predictor, const GameState *authoritative,
+                      unsigned int frame);
+
+// Newest predicted state, NULL before the first authoritative state
+const GameState *PredictorState(const Predictor *predictor);
+
+#endif // PREDICTION_H
@@ -0,0 +1,406 @@
+/*
+ * projectiles.c
+ *
+ * The shared projectile pool (see ProjectileStore in simulation.h) with
+ * three interchangeable kernels for the hot movement loop (hits are
+ * resolved per cell in simulation.c):
+ *
+ *    - SCALAR: plain C, the reference behaviour, used on every CPU
+ *    - SSE41:  4 projectiles at a time
+ *    - AVX2:   8 projectiles at a time
+ *
+ * Walls never move, so how far a projectile flies is known when it is
+ * fired (FireRange, from the map's line-of-fire table) and kept as its
+ * lifetime. The kernels never look at the map: a step is an add and a
+ * decrement, and a lifetime at 0 means the next cell is solid.
+ *
+ * The kernels only mark which projectiles hit something; one shared
+ * pass then removes those, last first, so the pool ends up in the same
+ * order whichever kernel ran.
+ *
+ * The SIMD kernels are only built for x86 with gcc/clang and picked at
+ * runtime, so the same binary still runs (scalar) on older CPUs and
+ * other architectures get the scalar path automatically.
+ */
+
+#include "simulation.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PROJECTILES_X86 1
+#include <immintrin.h>
+#endif
+
+// The kernels work in whole 8-lane blocks, the last one reaching past
+// the live projectiles but never past the arrays
+_Static_assert(PROJECTILE_LANES % 8 == 0, "Pool must hold whole blocks");
+
+// One bit per lane: the projectiles a kernel found blocked
+#define BLOCKED_WORDS ((PROJECTILE_LANES + 31) / 32)
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void AdvanceScalar(ProjectileStore *store, unsigned int *blocked);
+static void RemoveBlocked(ProjectileStore *store, const unsigned int *blocked);
+
+#ifdef PROJECTILES_X86
+static void AdvanceSse41(ProjectileStore *store, unsigned int *blocked);
+static void AdvanceAvx2(ProjectileStore *store, unsigned int *blocked);
+#endif
+
+// ---------------------------------------------------------------------
+//  Kernel selection
+// ---------------------------------------------------------------------
+// -1 until first use; atomic because batch workers read it concurrently
+static atomic_int kernel = -1;
+
+ProjectileKernel ProjectilesBestKernel(void)
+{
+#ifdef PROJECTILES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return PROJECTILE_KERNEL_AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return PROJECTILE_KERNEL_SSE41;
+#endif
+    return PROJECTILE_KERNEL_SCALAR;
+}
+
+void ProjectilesSetKernel(ProjectileKernel k)
+{
+    // Never hand out a kernel the CPU cannot run
+    if (k > ProjectilesBestKernel())
+        k = ProjectilesBestKernel();
+    atomic_store_explicit(&kernel, (int)k, memory_order_relaxed);
+}
+
+static ProjectileKernel CurrentKernel(void)
+{
+    int k = atomic_load_explicit(&kernel, memory_order_relaxed);
+    if (k < 0)
+    {
+        k = (int)ProjectilesBestKernel();
+        atomic_store_explicit(&kernel, k, memory_order_relaxed);
+    }
+    return (ProjectileKernel)k;
+}
+
+const char *ProjectileKernelName(ProjectileKernel k)
+{
+    switch (k)
+    {
+    case PROJECTILE_KERNEL_AVX2:
+        return "avx2";
+    case PROJECTILE_KERNEL_SSE41:
+        return "sse4.1";
+    default:
+        return "scalar";
+    }
+}
+
+// ---------------------------------------------------------------------
+//  Pool management
+//    Ids are handed out lazily: `issued` marks the first id never used,
+//    and only ids given back go on the free list, so clearing the pool
+//    does not have to touch every entry.
+// ---------------------------------------------------------------------
+void ProjectilesClear(ProjectileStore *store)
+{
+    store->count = 0;
+    store->freeHead = -1;
+    store->issued = 0;
+    memset(store->inFlight, 0, sizeof(store->inFlight));
+}
+
+bool ProjectileFire(ProjectileStore *store, const GameMap *map, int owner,
+                    int x, int y, int dx, int dy)
+{
+    if (store->inFlight[owner] >= MAX_PROJECTILES)
+        return false;
+
+    int id;
+    if (store->freeHead >= 0)
+    {
+        id = store->freeHead;
+        store->freeHead = store->nextFree[id];
+    }
+    else if (store->issued < PROJECTILE_CAPACITY)
+    {
+        id = store->issued++;
+    }
+    else
+    {
+        return false;
+    }
+
+    int i = store->count++;
+    store->x[i] = x;
+    store->y[i] = y;
+    store->dx[i] = dx;
+    store->dy[i] = dy;
+    store->life[i] = FireRange(map, x, y, dx, dy);
+    store->owner[i] = owner;
+    store->id[i] = id;
+    store->indexOf[id] = i;
+    store->inFlight[owner]++;
+    return true;
+}
+
+void ProjectileRemove(ProjectileStore *store, int index)
+{
+    int id = store->id[index];
+    store->nextFree[id] = store->freeHead;
+    store->freeHead = id;
+    store->inFlight[store->owner[index]]--;
+
+    int last = --store->count;
+    if (index != last)
+    {
+        store->x[index] = store->x[last];
+        store->y[index] = store->y[last];
+        store->dx[index] = store->dx[last];
+        store->dy[index] = store->dy[last];
+        store->life[index] = store->life[last];
+        store->owner[index] = store->owner[last];
+        store->id[index] = store->id[last];
+        store->indexOf[store->id[index]] = index;
+    }
+}
+
+// The lanes in [0, count) and the id arrays in [0, issued): nothing
+// past those is read before it is written again
+void ProjectilesCopy(ProjectileStore *dst, const ProjectileStore *src, int players)
+{
+    size_t lanes = sizeof(int) * (size_t)src->count;
+    memcpy(dst->x, src->x, lanes);
+    memcpy(dst->y, src->y, lanes);
+    memcpy(dst->dx, src->dx, lanes);
+    memcpy(dst->dy, src->dy, lanes);
+    memcpy(dst->life, src->life, lanes);
+    memcpy(dst->owner, src->owner, lanes);
+    memcpy(dst->id, src->id, lanes);
+    dst->count = src->count;
+
+    size_t ids = sizeof(int) * (size_t)src->issued;
+    memcpy(dst->indexOf, src->indexOf, ids);
+    memcpy(dst->nextFree, src->nextFree, ids);
+    dst->freeHead = src->freeHead;
+    dst->issued = src->issued;
+    memcpy(dst->inFlight, src->inFlight, sizeof(int) * (size_t)players);
+}
+
+int ProjectileIndex(const ProjectileStore *store, int id)
+{
+    if (id < 0 || id >= store->issued)
+        return -1;
+
+    // indexOf is stale for ids on the free list
+    int i = store->indexOf[id];
+    return (i < store->count && store->id[i] == id) ? i : -1;
+}
+
+bool ProjectilesReindex(ProjectileStore *store)
+{
+    if (store->count < 0 || store->count > PROJECTILE_CAPACITY)
+        return false;
+
+    memset(store->inFlight, 0, sizeof(store->inFlight));
+    for (int id = 0; id < PROJECTILE_CAPACITY; id++)
+        store->indexOf[id] = -1;
+
+    for (int i = 0; i < store->count; i++)
+    {
+        int id = store->id[i];
+        int owner = store->owner[i];
+        if (id < 0 || id >= PROJECTILE_CAPACITY || store->indexOf[id] >= 0 ||
+            owner < 0 || owner >= MAX_PLAYERS ||
+            ++store->inFlight[owner] > MAX_PROJECTILES)
+            return false;
+        store->indexOf[id] = i;
+    }
+
+    // Ids past the highest in flight count as never used, every unused
+    // one below it goes on the free list, lowest first: either way the
+    // lowest free id is handed out next
+    store->issued = 0;
+    for (int i = 0; i < store->count; i++)
+    {
+        if (store->id[i] >= store->issued)
+            store->issued = store->id[i] + 1;
+    }
+    store->freeHead = -1;
+    for (int id = store->issued - 1; id >= 0; id--)
+    {
+        if (store->indexOf[id] < 0)
+        {
+            store->nextFree[id] = store->freeHead;
+            store->freeHead = id;
+        }
+    }
+    return true;
+}
+
+bool ProjectilesMeasure(ProjectileStore *store, const GameMap *map)
+{
+    for (int i = 0; i < store->count; i++)
+    {
+        int x = store->x[i];
+        int y = store->y[i];
+        int dx = store->dx[i];
+        int dy = store->dy[i];
+        if (x < 0 || x >= map->width || y < 0 || y >= map->height ||
+            dx < -1 || dx > 1 || dy < -1 || dy > 1 || (dx == 0 && dy == 0))
+            return false;
+        store->life[i] = FireRange(map, x, y, dx, dy);
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------
+//  Dispatch
+// ---------------------------------------------------------------------
+void ProjectilesAdvance(ProjectileStore *store)
+{
+    if (store->count == 0)
+        return;
+
+    unsigned int blocked[BLOCKED_WORDS] = {0};
+    switch (CurrentKernel())
+    {
+#ifdef PROJECTILES_X86
+    case PROJECTILE_KERNEL_AVX2:
+        AdvanceAvx2(store, blocked);
+        break;
+    case PROJECTILE_KERNEL_SSE41:
+        AdvanceSse41(store, blocked);
+        break;
+#endif
+    default:
+        AdvanceScalar(store, blocked);
+        break;
+    }
+    RemoveBlocked(store, blocked);
+}
+
+// Lanes are independent and the steps known, so this vectorizes as is
+void ProjectilesFly(ProjectileStore *store, int steps)
+{
+    for (int i = 0; i < store->count; i++)
+    {
+        store->x[i] += store->dx[i] * steps;
+        store->y[i] += store->dy[i] * steps;
+        store->life[i] -= steps;
+    }
+}
+
+// Highest index first, so the projectile swapped into a hole has
+// always already moved and is never blocked itself
+static void RemoveBlocked(ProjectileStore *store, const unsigned int *blocked)
+{
+    for (int w = (store->count - 1) / 32; w >= 0; w--)
+    {
+        unsigned int bits = blocked[w];
+        while (bits != 0)
+        {
+            int top = 31 - __builtin_clz(bits);
+            bits &= ~(1u << top);
+            ProjectileRemove(store, w * 32 + top);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+//  Scalar kernel (reference)
+// ---------------------------------------------------------------------
+static void AdvanceScalar(ProjectileStore *store, unsigned int *blocked)
+{
+    for (int i = 0; i < store->count; i++)
+    {
+        if (store->life[i] == 0)
+        {
+            // obstacle or boundary next
+            blocked[i / 32] |= 1u << (i % 32);
+        }
+        else
+        {
+            store->x[i] += store->dx[i];
+            store->y[i] += store->dy[i];
+            store->life[i]--;
+        }
+    }
+}
+
+#ifdef PROJECTILES_X86
+
+// Lane mask of the `width`-lane block starting at `base`: all set except
+// in the last block, where lanes at or past count are idle
+static inline unsigned int LiveLanes(int count, int base, int width)
+{
+    int live = count - base;
+    return (live >= width) ? (1u << width) - 1u : (1u << live) - 1u;
+}
+
+// ---------------------------------------------------------------------
+//  SSE4.1 kernel
+//    4 lanes at a time; a moving lane's mask is all ones, so adding it
+//    counts the lifetime down
+// ---------------------------------------------------------------------
+__attribute__((target("sse4.1")))
+static void AdvanceSse41(ProjectileStore *store, unsigned int *blocked)
+{
+    const __m128i laneBit = _mm_setr_epi32(1, 2, 4, 8);
+
+    for (int base = 0; base < store->count; base += 4)
+    {
+        unsigned int bits = LiveLanes(store->count, base, 4);
+        __m128i live = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)bits), laneBit), laneBit);
+
+        __m128i life = _mm_loadu_si128((const __m128i *)&store->life[base]);
+        __m128i move = _mm_andnot_si128(_mm_cmpeq_epi32(life, _mm_setzero_si128()), live);
+        __m128i x = _mm_loadu_si128((const __m128i *)&store->x[base]);
+        __m128i y = _mm_loadu_si128((const __m128i *)&store->y[base]);
+        __m128i dx = _mm_and_si128(_mm_loadu_si128((const __m128i *)&store->dx[base]), move);
+        __m128i dy = _mm_and_si128(_mm_loadu_si128((const __m128i *)&store->dy[base]), move);
+        _mm_storeu_si128((__m128i *)&store->x[base], _mm_add_epi32(x, dx));
+        _mm_storeu_si128((__m128i *)&store->y[base], _mm_add_epi32(y, dy));
+        _mm_storeu_si128((__m128i *)&store->life[base], _mm_add_epi32(life, move));
+
+        unsigned int moved = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(move));
+        blocked[base / 32] |= (bits & ~moved) << (base % 32);
+    }
+}
+
+// ---------------------------------------------------------------------
+//  AVX2 kernel
+//    The same 8 lanes at a time
+// ---------------------------------------------------------------------
+__attribute__((target("avx2")))
+static void AdvanceAvx2(ProjectileStore *store, unsigned int *blocked)
+{
+    const __m256i laneBit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    for (int base = 0; base < store->count; base += 8)
+    {
+        unsigned int bits = LiveLanes(store->count, base, 8);
+        __m256i live = _mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32((int)bits), laneBit), laneBit);
+
+        __m256i life = _mm256_loadu_si256((const __m256i *)&store->life[base]);
+        __m256i move = _mm256_andnot_si256(_mm256_cmpeq_epi32(life, _mm256_setzero_si256()), live);
+        __m256i x = _mm256_loadu_si256((const __m256i *)&store->x[base]);
+        __m256i y = _mm256_loadu_si256((const __m256i *)&store->y[base]);
+        __m256i dx = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&store->dx[base]), move);
+        __m256i dy = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)&store->dy[base]), move);
+        _mm256_storeu_si256((__m256i *)&store->x[base], _mm256_add_epi32(x, dx));
+        _mm256_storeu_si256((__m256i *)&store->y[base], _mm256_add_epi32(y, dy));
+        _mm256_storeu_si256((__m256i *)&store->life[base], _mm256_add_epi32(life, move));
+
+        unsigned int moved = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(move));
+        blocked[base / 32] |= (bits & ~moved) << (base % 32);
+    }
+}
+
+#endif // PROJECTILES_X86
@@ -0,0 +1,274 @@
+/*
+ * replay.c
+ *
+ * Writer and reader for the replay log described in replay.h.
+ */
+
+#include "replay.h"
+
+#include <string.h>
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+#define REPLAY_MAGIC "MMXR"
+
+#define REPLAY_REC_INPUT 0x01
+#define REPLAY_REC_HASH 0x02
+#define REPLAY_REC_END 0x03
+
+#define KEY_BITS 5 // INPUT_UP .. INPUT_FIRE
+#define PackedKeyBytes(players) ((size_t)((players) * KEY_BITS + 7) / 8)
+#define PACKED_KEY_BYTES PackedKeyBytes(MAX_PLAYERS)
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void PutVarint(FILE *file, unsigned long long value);
+static bool GetVarint(FILE *file, unsigned long long *value);
+static void PutU64(FILE *file, unsigned long long value);
+static bool GetU64(FILE *file, unsigned long long *value);
+static void PackKeys(const InputFrame *input, int playerCount, unsigned char *packed);
+static void UnpackKeys(const unsigned char *packed, int playerCount, InputFrame *input);
+static void FlushRun(ReplayWriter *writer);
+
+// ---------------------------------------------------------------------
+//  ReplayRollHash
+// ---------------------------------------------------------------------
+unsigned long long ReplayRollHash(unsigned long long hash, const GameState *game)
+{
+    hash = (hash << 7) | (hash >> 57);
+    return (hash ^ HashGameState(game)) * 0x9E3779B97F4A7C15ULL;
+}
+
+// ---------------------------------------------------------------------
+//  Writer
+// ---------------------------------------------------------------------
+bool ReplayWriterOpen(ReplayWriter *writer, const char *path, int tickRate,
+                      const GameState *start)
+{
+    const GameMap *map = start->map;
+
+    memset(writer, 0, sizeof(ReplayWriter));
+    writer->playerCount = start->playerCount;
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL)
+        return false;
+
+    fwrite(REPLAY_MAGIC, 1, 4, writer->file);
+    fputc(REPLAY_VERSION, writer->file);
+    fputc(start->playerCount & 0xFF, writer->file);
+    fputc((start->playerCount >> 8) & 0xFF, writer->file);
+    fputc(tickRate & 0xFF, writer->file);
+    fputc((tickRate >> 8) & 0xFF, writer->file);
+    fputc(map->width & 0xFF, writer->file);
+    fputc((map->width >> 8) & 0xFF, writer->file);
+    fputc(map->height & 0xFF, writer->file);
+    fputc((map->height >> 8) & 0xFF, writer->file);
+    return true;
+}
+
+void ReplayWriterTick(ReplayWriter *writer, const InputFrame *input,
+                      const GameState *after)
+{
+    if (writer->runLength > 0 && memcmp(&writer->run, input, sizeof(InputFrame)) != 0)
+        FlushRun(writer);
+
+    writer->run = *input;
+    writer->runLength++;
+    writer->ticks++;
+    writer->hash = ReplayRollHash(writer->hash, after);
+
+    if (writer->ticks % REPLAY_CHECKPOINT_TICKS == 0)
+    {
+        FlushRun(writer);
+        fputc(REPLAY_REC_HASH, writer->file);
+        PutVarint(writer->file, (unsigned long long)writer->ticks);
+        PutU64(writer->file, writer->hash);
+        // A crash loses at most the ticks since this checkpoint
+        fflush(writer->file);
+    }
+}
+
+bool ReplayWriterClose(ReplayWriter *writer)
+{
+    if (writer->file == NULL)
+        return false;
+
+    FlushRun(writer);
+    fputc(REPLAY_REC_END, writer->file);
+    PutVarint(writer->file, (unsigned long long)writer->ticks);
+    PutU64(writer->file, writer->hash);
+
+    bool ok = !ferror(writer->file);
+    if (fclose(writer->file) != 0)
+        ok = false;
+    writer->file = NULL;
+    return ok;
+}
+
+static void FlushRun(ReplayWriter *writer)
+{
+    if (writer->runLength == 0)
+        return;
+
+    unsigned char packed[PACKED_KEY_BYTES];
+    PackKeys(&writer->run, writer->playerCount, packed);
+    fputc(REPLAY_REC_INPUT, writer->file);
+    PutVarint(writer->file, (unsigned long long)writer->runLength);
+    fwrite(packed, 1, PackedKeyBytes(writer->playerCount), writer->file);
+    writer->runLength = 0;
+}
+
+// ---------------------------------------------------------------------
+//  Reader
+// ---------------------------------------------------------------------
+bool ReplayReaderOpen(ReplayReader *reader, const char *path)
+{
+    memset(reader, 0, sizeof(ReplayReader));
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL)
+        return false;
+
+    unsigned char header[13];
+    int players = 0;
+    if (fread(header, 1, sizeof(header), reader->file) == sizeof(header))
+        players = header[5] | (header[6] << 8);
+
+    // A match with more players than this build holds cannot be replayed
+    if (players < 2 || players > MAX_PLAYERS ||
+        memcmp(header, REPLAY_MAGIC, 4) != 0 ||
+        header[4] != REPLAY_VERSION)
+    {
+        fclose(reader->file);
+        reader->file = NULL;
+        return false;
+    }
+
+    reader->playerCount = players;
+    reader->tickRate = header[7] | (header[8] << 8);
+    reader->mapWidth = header[9] | (header[10] << 8);
+    reader->mapHeight = header[11] | (header[12] << 8);
+    return true;
+}
+
+ReplayEvent ReplayReaderNext(ReplayReader *reader, InputFrame *input,
+                             long long *tick, unsigned long long *hash)
+{
+    if (reader->runLeft > 0)
+    {
+        reader->runLeft--;
+        *input = reader->run;
+        return REPLAY_TICK;
+    }
+
+    unsigned long long value;
+    unsigned char packed[PACKED_KEY_BYTES];
+    int tag = fgetc(reader->file);
+
+    switch (tag)
+    {
+    case REPLAY_REC_INPUT:
+        if (!GetVarint(reader->file, &value) || value == 0 ||
+            fread(packed, 1, PackedKeyBytes(reader->playerCount), reader->file) !=
+                PackedKeyBytes(reader->playerCount))
+            return REPLAY_ERROR;
+        UnpackKeys(packed, reader->playerCount, &reader->run);
+        reader->runLeft = (long long)value - 1;
+        *input = reader->run;
+        return REPLAY_TICK;
+
+    case REPLAY_REC_HASH:
+    case REPLAY_REC_END:
+        if (!GetVarint(reader->file, &value) || !GetU64(reader->file, hash))
+            return REPLAY_ERROR;
+        *tick = (long long)value;
+        return (tag == REPLAY_REC_HASH) ? REPLAY_CHECKPOINT : REPLAY_END;
+
+    default:
+        return REPLAY_ERROR;
+    }
+}
+
+void ReplayReaderClose(ReplayReader *reader)
+{
+    if (reader->file != NULL)
+        fclose(reader->file);
+    reader->file = NULL;
+}
+
+// ---------------------------------------------------------------------
+//  Encoding helpers
+// ---------------------------------------------------------------------
+static void PutVarint(FILE *file, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int)(value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static bool GetVarint(FILE *file, unsigned long long *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int c = fgetc(file);
+        if (c == EOF)
+            return false;
+        *value |= (unsigned long long)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void PutU64(FILE *file, unsigned long long value)
+{
+    for (int b = 0; b < 8; b++)
+        fputc((int)((value >> (b * 8)) & 0xFF), file);
+}
+
+static bool GetU64(FILE *file, unsigned long long *value)
+{
+    unsigned char bytes[8];
+    if (fread(bytes, 1, 8, file) != 8)
+        return false;
+
+    *value = 0;
+    for (int b = 0; b < 8; b++)
+        *value |= (unsigned long long)bytes[b] << (b * 8);
+    return true;
+}
+
+static void PackKeys(const InputFrame *input, int playerCount, unsigned char *packed)
+{
+    memset(packed, 0, PackedKeyBytes(playerCount));
+    for (int i = 0; i < playerCount; i++)
+    {
+        for (int b = 0; b < KEY_BITS; b++)
+        {
+            if (input->keys[i] & (1u << b))
+            {
+                int bit = i * KEY_BITS + b;
+                packed[bit / 8] |= (unsigned char)(1u << (bit % 8));
+            }
+        }
+    }
+}
+
+static void UnpackKeys(const unsigned char *packed, int playerCount, InputFrame *input)
+{
+    memset(input, 0, sizeof(InputFrame));
+    for (int i = 0; i < playerCount; i++)
+    {
+        for (int b = 0; b < KEY_BITS; b++)
+        {
+            int bit = i * KEY_BITS + b;
+            if (packed[bit / 8] & (1u << (bit % 8)))
+                input->keys[i] |= (unsigned char)(1u << b);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * replay.h
+ *
+ * Deterministic match recording. Every tick's InputFrame is written to a
+ * streaming binary log together with periodic checkpoints of a rolling
+ * hash of the GameState, so a recorded match can be re-simulated
+ * headlessly and proven to end in exactly the same state.
+ *
+ * File layout (all integers little endian):
+ *    header:   "MMXR", u8 version, u16 players, u16 tickRate,
+ *              u16 map width, u16 map height
+ *    records:  REPLAY_REC_INPUT  varint run, keys bitpacked 5 bits/player
+ *              REPLAY_REC_HASH   varint tick, u64 rolling hash
+ *              REPLAY_REC_END    varint tick, u64 rolling hash
+ *
+ * Consecutive ticks with identical keys share one INPUT record, so a
+ * held direction costs a couple of bytes however long it is held.
+ *
+ * The map is fully described by its size (MapCreate), so the replayer
+ * rebuilds it and the starting state (InitGame) from the header.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+
+#include "simulation.h"
+
+#define REPLAY_VERSION 4
+#define REPLAY_CHECKPOINT_TICKS 60 // One hash record per second at 60 Hz
+
+typedef struct
+{
+    FILE *file;
+    int playerCount;
+    InputFrame run;          // Keys of the run being collected
+    long long runLength;     // Ticks in that run (0 = none yet)
+    long long ticks;         // Ticks recorded so far
+    unsigned long long hash; // Rolling state hash after the last tick
+} ReplayWriter;
+
+typedef enum
+{
+    REPLAY_TICK,       // *input holds the next tick's input
+    REPLAY_CHECKPOINT, // *tick / *hash hold a recorded checkpoint
+    REPLAY_END,        // *tick / *hash hold the final totals
+    REPLAY_ERROR       // Truncated or corrupt log
+} ReplayEvent;
+
+typedef struct
+{
+    FILE *file;
+    int tickRate;
+    int playerCount;
+    int mapWidth, mapHeight;
+    InputFrame run;
+    long long runLeft; // Ticks left in the current INPUT record
+} ReplayReader;
+
+// Fold one tick's state into a rolling hash (start from 0)
+unsigned long long ReplayRollHash(unsigned long long hash, const GameState *game);
+
+// `start` is the freshly initialised match (InitGame) about to be played
+bool ReplayWriterOpen(ReplayWriter *writer, const char *path, int tickRate,
+                      const GameState *start);
+// Record one tick: the input fed to SimStep and the state it produced
+void ReplayWriterTick(ReplayWriter *writer, const InputFrame *input,
+                      const GameState *after);
+bool ReplayWriterClose(ReplayWriter *writer);
+
+bool ReplayReaderOpen(ReplayReader *reader, const char *path);
+ReplayEvent ReplayReaderNext(ReplayReader *reader, InputFrame *input,
+                             long long *tick, unsigned long long *hash);
+void ReplayReaderClose(ReplayReader *reader);
+
+#endif // REPLAY_H
@@ -0,0 +1,525 @@
+/*
+ * server.c
+ *
+ * Authoritative match server (see server.h).
+ */
+
+#include "server.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "net.h"
+#include "snapshot.h"
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+#define SEAT_INDEX_BITS 20 // Low bits of a token; the rest is a generation
+#define MAX_SEATS (1 << SEAT_INDEX_BITS)
+
+// Inputs waiting per seat. Each tick steps with one, so a client's
+// frames and the server's ticks stay in step through network jitter;
+// past INPUT_BACKLOG waiting (a client clock running fast) the oldest
+// are skipped rather than adding delay.
+#define INPUT_QUEUE 8
+#define INPUT_BACKLOG 4
+#define MOVE_KEYS (INPUT_UP | INPUT_DOWN | INPUT_LEFT | INPUT_RIGHT)
+
+// ---------------------------------------------------------------------
+//  Structs
+// ---------------------------------------------------------------------
+typedef struct
+{
+    bool used;
+    struct sockaddr_in addr;
+    unsigned int nonce;
+    unsigned int token;
+    int match, player;
+    bool heard;                // Any input yet
+    unsigned int sequence;     // Of the newest input
+    unsigned int applied;      // Input the last tick stepped with, 0 = none
+    unsigned char held;        // Its movement keys, repeated while starved
+    unsigned int queuedSequence[INPUT_QUEUE];
+    unsigned char queuedKeys[INPUT_QUEUE];
+    int queueFirst, queueCount;
+    unsigned int ack;          // Newest tick the client decoded
+    double lastHeard;
+    int nextFree;
+} Seat;
+
+typedef struct
+{
+    int seats[MAX_PLAYERS]; // Seat per player, -1 once it left
+    int joined;             // Players seated so far
+    int present;            // Seats still taken
+    bool running;           // Every player seated: stepped each tick
+    unsigned int tick;      // Tick of the newest state
+    InputFrame used;        // Input of the newest tick
+    // State after tick t lives in history[t % NET_HISTORY]
+    GameState history[NET_HISTORY];
+    int nextFree;
+} Match;
+
+struct Server
+{
+    ServerConfig config;
+    GameMap *map;
+    NetSocket sock;
+    double now; // NetNow() at the last poll
+
+    Match *matches;
+    int freeMatch; // Free list heads, -1 when empty
+    int filling;   // Match taking new players, -1 for none
+    Seat *seats;
+    int seatCount;
+    int freeSeat;
+    unsigned int generation;
+    double nextTimeoutCheck;
+
+    ServerStats stats;
+};
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void HandlePacket(Server *server, const struct sockaddr_in *from,
+                         const unsigned char *data, size_t length);
+static void HandleHello(Server *server, const struct sockaddr_in *from, unsigned int nonce);
+static void HandleInput(Server *server, const struct sockaddr_in *from,
+                        const unsigned char *data);
+static Seat *FindSeat(Server *server, const struct sockaddr_in *from, unsigned int token);
+static void SendWelcome(Server *server, const Seat *seat);
+static void LeaveSeat(Server *server, int index);
+static unsigned char NextInput(Server *server, Seat *seat);
+static void StepMatch(Server *server, Match *match);
+static void SendStates(Server *server, Match *match);
+static void CheckTimeouts(Server *server);
+
+// ---------------------------------------------------------------------
+//  Create / destroy
+// ---------------------------------------------------------------------
+void ServerDefaultConfig(ServerConfig *config)
+{
+    config->port = NET_DEFAULT_PORT;
+    config->tickRate = 60;
+    config->playersPerMatch = DEFAULT_PLAYERS;
+    config->mapWidth = DEFAULT_MAP_WIDTH;
+    config->mapHeight = DEFAULT_MAP_HEIGHT;
+    config->maxMatches = 1024;
+    config->clientTimeout = 5.0;
+}
+
+Server *ServerCreate(const ServerConfig *config)
+{
+    int players = config->playersPerMatch;
+    int projectiles = players * MAX_PROJECTILES;
+    if (projectiles > PROJECTILE_CAPACITY)
+        projectiles = PROJECTILE_CAPACITY;
+
+    // Every state has to fit one datagram
+    if (players < 2 || players > MAX_PLAYERS ||
+        SnapshotMaxBytes(players, projectiles) > NET_MAX_PACKET - NET_STATE_HEADER - players ||
+        config->tickRate <= 0 || config->maxMatches <= 0 ||
+        (long long)config->maxMatches * players > MAX_SEATS)
+        return NULL;
+
+    Server *server = calloc(1, sizeof(Server));
+    if (server == NULL)
+        return NULL;
+    server->config = *config;
+    server->sock.fd = -1;
+    server->map = MapCreate(config->mapWidth, config->mapHeight);
+    server->matches = calloc((size_t)config->maxMatches, sizeof(Match));
+    server->seatCount = config->maxMatches * players;
+    server->seats = calloc((size_t)server->seatCount, sizeof(Seat));
+    if (server->map == NULL || server->matches == NULL || server->seats == NULL ||
+        !NetOpen(&server->sock, config->port))
+    {
+        ServerDestroy(server);
+        return NULL;
+    }
+
+    for (int m = 0; m < config->maxMatches; m++)
+        server->matches[m].nextFree = (m + 1 < config->maxMatches) ? m + 1 : -1;
+    for (int s = 0; s < server->seatCount; s++)
+        server->seats[s].nextFree = (s + 1 < server->seatCount) ? s + 1 : -1;
+    server->freeMatch = 0;
+    server->freeSeat = 0;
+    server->filling = -1;
+    server->now = NetNow();
+    server->nextTimeoutCheck = server->now + 1.0;
+    return server;
+}
+
+void ServerDestroy(Server *server)
+{
+    if (server == NULL)
+        return;
+    if (server->sock.fd >= 0)
+        NetClose(&server->sock);
+    MapFree(server->map);
+    free(server->matches);
+    free(server->seats);
+    free(server);
+}
+
+void ServerGetStats(const Server *server, ServerStats *stats)
+{
+    *stats = server->stats;
+    stats->packetsSent = server->sock.packetsSent;
+    stats->bytesSent = server->sock.bytesSent;
+    stats->packetsReceived = server->sock.packetsReceived;
+    stats->bytesReceived = server->sock.bytesReceived;
+    stats->sendErrors = server->sock.sendErrors;
+}
+
+// ---------------------------------------------------------------------
+//  ServerPoll
+// ---------------------------------------------------------------------
+void ServerPoll(Server *server, double seconds)
+{
+    NetSocket *sock = &server->sock;
+    if (seconds > 0.0)
+        NetWait(&sock, 1, seconds);
+
+    server->now = NetNow();
+    struct sockaddr_in from;
+    const unsigned char *data;
+    size_t length;
+    while (NetReceive(sock, &from, &data, &length))
+        HandlePacket(server, &from, data, length);
+    NetFlush(sock);
+}
+
+static void HandlePacket(Server *server, const struct sockaddr_in *from,
+                         const unsigned char *data, size_t length)
+{
+    if (length == 0)
+        return;
+
+    switch (data[0])
+    {
+    case NET_HELLO:
+        if (length == NET_HELLO_BYTES && data[1] == NET_VERSION)
+            HandleHello(server, from, NetGetU32(data + 2));
+        break;
+
+    case NET_INPUT:
+        if (length == NET_INPUT_BYTES)
+            HandleInput(server, from, data);
+        break;
+
+    case NET_BYE:
+        if (length == NET_BYE_BYTES)
+        {
+            Seat *seat = FindSeat(server, from, NetGetU32(data + 1));
+            if (seat != NULL)
+                LeaveSeat(server, (int)(seat - server->seats));
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+// ---------------------------------------------------------------------
+//  Seating
+// ---------------------------------------------------------------------
+static void HandleHello(Server *server, const struct sockaddr_in *from, unsigned int nonce)
+{
+    // A repeated hello means the welcome got lost
+    for (int s = 0; s < server->seatCount; s++)
+    {
+        Seat *seat = &server->seats[s];
+        if (seat->used && seat->nonce == nonce && NetSameAddress(&seat->addr, from))
+        {
+            SendWelcome(server, seat);
+            return;
+        }
+    }
+
+    if (server->filling < 0)
+    {
+        server->filling = server->freeMatch;
+        if (server->filling >= 0)
+        {
+            Match *match = &server->matches[server->filling];
+            server->freeMatch = match->nextFree;
+            match->joined = 0;
+            match->present = 0;
+            match->running = false;
+        }
+    }
+    if (server->filling < 0 || server->freeSeat < 0)
+    {
+        unsigned char reject[NET_REJECT_BYTES];
+        reject[0] = NET_REJECT;
+        NetPutU32(reject + 1, nonce);
+        NetSend(&server->sock, from, reject, sizeof(reject));
+        server->stats.rejected++;
+        return;
+    }
+
+    int index = server->freeSeat;
+    Seat *seat = &server->seats[index];
+    server->freeSeat = seat->nextFree;
+    Match *match = &server->matches[server->filling];
+
+    memset(seat, 0, sizeof(Seat));
+    seat->used = true;
+    seat->addr = *from;
+    seat->nonce = nonce;
+    seat->token = (unsigned int)index | (++server->generation << SEAT_INDEX_BITS);
+    seat->match = server->filling;
+    seat->player = match->joined;
+    seat->ack = NET_NO_TICK;
+    seat->lastHeard = server->now;
+    match->seats[match->joined++] = index;
+    match->present++;
+    server->stats.clients++;
+    SendWelcome(server, seat);
+
+    if (match->joined == server->config.playersPerMatch)
+    {
+        InitGame(&match->history[0], server->map, match->joined);
+        match->tick = 0;
+
+        match->running = true;
+        server->filling = -1;
+        server->stats.matches++;
+    }
+}
+
+static void SendWelcome(Server *server, const Seat *seat)
+{
+    unsigned char welcome[NET_WELCOME_BYTES];
+    welcome[0] = NET_WELCOME;
+    NetPutU32(welcome + 1, seat->nonce);
+    NetPutU32(welcome + 5, seat->token);
+    NetPutU16(welcome + 9, (unsigned int)seat->player);
+    NetPutU16(welcome + 11, (unsigned int)server->config.playersPerMatch);
+    NetPutU16(welcome + 13, (unsigned int)server->config.tickRate);
+    NetPutU16(welcome + 15, (unsigned int)server->config.mapWidth);
+    NetPutU16(welcome + 17, (unsigned int)server->config.mapHeight);
+    NetSend(&server->sock, &seat->addr, welcome, sizeof(welcome));
+}
+
+static Seat *FindSeat(Server *server, const struct sockaddr_in *from, unsigned int token)
+{
+    int index = (int)(token & (MAX_SEATS - 1));
+    if (index >= server->seatCount)
+        return NULL;
+
+    Seat *seat = &server->seats[index];
+    if (!seat->used || seat->token != token || !NetSameAddress(&seat->addr, from))
+        return NULL;
+    return seat;
+}
+
+static void LeaveSeat(Server *server, int index)
+{
+    Seat *seat = &server->seats[index];
+    Match *match = &server->matches[seat->match];
+    match->seats[seat->player] = -1;
+
+    seat->used = false;
+    seat->nextFree = server->freeSeat;
+    server->freeSeat = index;
+    server->stats.clients--;
+
+    if (--match->present > 0)
+        return;
+
+    // Nobody left to play or watch it
+    if (match->running)
+        server->stats.matches--;
+    else
+        server->filling = -1;
+    match->running = false;
+    match->nextFree = server->freeMatch;
+    server->freeMatch = seat->match;
+}
+
+// ---------------------------------------------------------------------
+//  Input
+// ---------------------------------------------------------------------
+static void HandleInput(Server *server, const struct sockaddr_in *from,
+                        const unsigned char *data)
+{
+    Seat *seat = FindSeat(server, from, NetGetU32(data + 1));
+    if (seat == NULL)
+        return;
+    seat->lastHeard = server->now;
+
+    Match *match = &server->matches[seat->match];
+    unsigned int sequence = NetGetU32(data + 5);
+    unsigned int ack = NetGetU32(data + 9);
+    unsigned char keys = data[13];
+
+    // Inputs overtaken by a newer one are stale
+    if (seat->heard && (int)(sequence - seat->sequence) <= 0)
+        return;
+    if (seat->heard)
+        server->stats.inputsLost += sequence - seat->sequence - 1;
+    seat->heard = true;
+    seat->sequence = sequence;
+    server->stats.inputsReceived++;
+
+    if (seat->queueCount == INPUT_QUEUE)
+    {
+        seat->queueFirst = (seat->queueFirst + 1) % INPUT_QUEUE;
+        seat->queueCount--;
+        server->stats.inputsSkipped++;
+    }
+    int at = (seat->queueFirst + seat->queueCount++) % INPUT_QUEUE;
+    seat->queuedSequence[at] = sequence;
+    seat->queuedKeys[at] = keys & (MOVE_KEYS | INPUT_FIRE);
+
+    if (ack != NET_NO_TICK && match->running && match->tick - ack < NET_HISTORY &&
+        (seat->ack == NET_NO_TICK || (int)(ack - seat->ack) > 0))
+        seat->ack = ack;
+}
+
+// ---------------------------------------------------------------------
+//  ServerTick
+// ---------------------------------------------------------------------
+void ServerTick(Server *server)
+{
+    server->stats.ticks++;
+    for (int m = 0; m < server->config.maxMatches; m++)
+    {
+        Match *match = &server->matches[m];
+        if (!match->running)
+            continue;
+        StepMatch(server, match);
+        SendStates(server, match);
+    }
+    NetFlush(&server->sock);
+
+    if (server->now >= server->nextTimeoutCheck)
+    {
+        CheckTimeouts(server);
+        server->nextTimeoutCheck = server->now + 1.0;
+    }
+}
+
+static void StepMatch(Server *server, Match *match)
+{
+    const GameState *current = &match->history[match->tick % NET_HISTORY];
+    GameState *next = &match->history[(match->tick + 1) % NET_HISTORY];
+    match->tick++;
+
+    // Players who left get no input
+    memset(&match->used, 0, sizeof(InputFrame));
+    for (int p = 0; p < match->joined; p++)
+    {
+        if (match->seats[p] >= 0)
+            match->used.keys[p] = NextInput(server, &server->seats[match->seats[p]]);
+    }
+
+    // The gameOver state went out last tick, start over. The inputs
+    // taken for this tick count as spent.
+    if (current->gameOver)
+    {
+        memset(&match->used, 0, sizeof(InputFrame));
+        InitGame(next, server->map, current->playerCount);
+        return;
+    }
+
+    CopyGameState(next, current);
+    SimStep(next, &match->used);
+    server->stats.matchTicks++;
+    if (next->gameOver)
+        server->stats.matchesFinished++;
+}
+
+// The seat's next input in sequence order; a client whose input is late
+// keeps its movement keys for the tick (without firing again)
+static unsigned char NextInput(Server *server, Seat *seat)
+{
+    while (seat->queueCount > INPUT_BACKLOG)
+    {
+        seat->queueFirst = (seat->queueFirst + 1) % INPUT_QUEUE;
+        seat->queueCount--;
+        server->stats.inputsSkipped++;
+    }
+
+    if (seat->queueCount == 0)
+    {
+        if (seat->heard)
+            server->stats.inputsStarved++;
+        return seat->held;
+    }
+
+    unsigned char keys = seat->queuedKeys[seat->queueFirst];
+    seat->applied = seat->queuedSequence[seat->queueFirst];
+    seat->held = keys & MOVE_KEYS;
+    seat->queueFirst = (seat->queueFirst + 1) % INPUT_QUEUE;
+    seat->queueCount--;
+    return keys;
+}
+
+static void SendStates(Server *server, Match *match)
+{
+    const GameState *game = &match->history[match->tick % NET_HISTORY];
+    unsigned long long hash = HashGameState(game);
+
+    // Players usually acknowledge the same tick, so the payload for
+    // one base is encoded once and only the nonce and applied input
+    // are patched per seat
+    unsigned char packet[NET_MAX_PACKET];
+    size_t length = 0;
+    unsigned int encodedBase = 0;
+    size_t keysEnd = NET_STATE_HEADER + (size_t)game->playerCount;
+
+    for (int p = 0; p < match->joined; p++)
+    {
+        if (match->seats[p] < 0)
+            continue;
+        Seat *seat = &server->seats[match->seats[p]];
+
+        unsigned int base = seat->ack;
+        if (base != NET_NO_TICK && match->tick - base >= NET_HISTORY)
+            base = NET_NO_TICK;
+
+        if (length == 0 || base != encodedBase)
+        {
+            const GameState *from = (base == NET_NO_TICK) ? NULL
+                                                          : &match->history[base % NET_HISTORY];
+            size_t size = SnapshotEncode(game, from, packet + keysEnd,
+                                         sizeof(packet) - keysEnd);
+            if (size == 0)
+                continue;
+
+            packet[0] = NET_STATE;
+            NetPutU32(packet + 5, match->tick);
+            NetPutU32(packet + 9, base);
+            NetPutU64(packet + 13, hash);
+            memcpy(packet + NET_STATE_HEADER, match->used.keys, (size_t)game->playerCount);
+            length = keysEnd + size;
+            encodedBase = base;
+        }
+
+        NetPutU32(packet + 1, seat->nonce);
+        NetPutU32(packet + 21, seat->applied);
+        NetSend(&server->sock, &seat->addr, packet, length);
+        server->stats.statesSent++;
+        if (base != NET_NO_TICK)
+            server->stats.deltaStates++;
+    }
+}
+
+static void CheckTimeouts(Server *server)
+{
+    double oldest = server->now - server->config.clientTimeout;
+    for (int s = 0; s < server->seatCount; s++)
+    {
+        if (server->seats[s].used && server->seats[s].lastHeard < oldest)
+        {
+            LeaveSeat(server, s);
+            server->stats.timeouts++;
+        }
+    }
+}
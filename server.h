@@ -0,0 +1,77 @@
+/*
+ * server.h
+ *
+ * Authoritative match server: clients say hello over UDP (net.h) and
+ * are seated into matches of a fixed player count, filled in arrival
+ * order. Once every seat of a match is taken the server steps it at
+ * its own tick rate, each tick with the next input of every client in
+ * sequence order (one per tick, so client frames and server ticks stay
+ * in step), and after every tick sends each client the new state, as
+ * a delta against the last tick that client acknowledged.
+ *
+ * Everything runs on the calling thread: one socket, all matches in
+ * one array, so a single core serves as many matches as it can step
+ * and encode in a tick. The caller owns the clock (ServerPoll until the
+ * next tick is due, then ServerTick) and so measures tick jitter.
+ *
+ * A client that goes quiet for clientTimeout seconds (or says bye)
+ * loses its seat; its ship stays in the match without input. A match
+ * with no client left is freed, a finished one is restarted the tick
+ * after its gameOver state went out.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "simulation.h"
+
+typedef struct Server Server;
+
+typedef struct
+{
+    int port;
+    int tickRate;
+    int playersPerMatch;      // 2 .. MAX_PLAYERS, small enough for one datagram
+    int mapWidth, mapHeight;
+    int maxMatches;
+    double clientTimeout;     // Seconds
+} ServerConfig;
+
+typedef struct
+{
+    long long ticks;           // ServerTick calls
+    long long matchTicks;      // Match ticks simulated
+    long long matchesFinished; // Matches that reached gameOver
+    int clients;               // Seats taken
+    int matches;               // Matches being played
+    long long rejected;        // Hellos turned away (server full)
+    long long timeouts;        // Seats freed for silence
+
+    long long statesSent, deltaStates;
+    long long inputsReceived;
+    long long inputsLost;      // Gaps in the clients' input sequences
+    long long inputsSkipped;   // Dropped from a backlog (client clock fast)
+    long long inputsStarved;   // Ticks a client had no new input for
+    long long packetsSent, bytesSent;
+    long long packetsReceived, bytesReceived;
+    long long sendErrors;
+} ServerStats;
+
+// Sets every field to its default
+void ServerDefaultConfig(ServerConfig *config);
+
+// Binds the port and allocates every match up front. Returns NULL if
+// the config is out of range, the port is taken or memory runs out.
+Server *ServerCreate(const ServerConfig *config);
+void ServerDestroy(Server *server);
+
+// Handle every packet that arrives within `seconds` (0 = only those
+// already waiting), returning early once some were handled
+void ServerPoll(Server *server, double seconds);
+
+// Advance every full match by one tick and send the states
+void ServerTick(Server *server);
+
+void ServerGetStats(const Server *server, ServerStats *stats);
+
+#endif // SERVER_H
@@ -0,0 +1,895 @@
+/*
+ * simulation.c
+ *
+ * Game rules for "Monomaxia": map setup, input application, ship and
+ * projectile movement and hit detection. No raylib here; see
+ * simulation.h.
+ */
+
+#include "simulation.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "events.h"
+#include "grid.h"
+
+// The solid border around the bitboard is one cell wide
+_Static_assert(MAX_SPEED == 1, "Solidity border assumes one-cell moves");
+
+// Ship keeps positions and hp in shorts (see simulation.h)
+_Static_assert(MAX_MAP_SIZE <= 32767 && PROJECTILE_CAPACITY < 32767,
+               "Ship fields too narrow");
+
+// CheckHits grids the ships only above this many afloat
+#define GRID_MIN_SHIPS 8
+
+// Per-tick working memory sized by the compile-time caps. In a big
+// build (e.g. -DMAX_PLAYERS=1024 -DMAX_PROJECTILES=16) it runs to
+// hundreds of KB, more than a worker thread's stack may hold, so each
+// thread gets one on the heap the first time it steps (see Scratch).
+typedef struct
+{
+    int gridStorage[GRID_STORAGE_INTS(MAX_PLAYERS)];
+
+    // CheckHits: this tick's hits and their resolution order
+    int hitIndex[PROJECTILE_LANES];
+    int hitOwner[PROJECTILE_LANES];
+    int hitTarget[PROJECTILE_LANES];
+    int order[PROJECTILE_LANES];
+    int byTarget[PROJECTILE_LANES];
+    int sortStart[MAX_PLAYERS + 1];
+    unsigned int spent[(PROJECTILE_LANES + 31) / 32];
+
+    // SimIdle: each projectile's next impact (SimStep runs meanwhile,
+    // so nothing above may be shared with it)
+    ScheduledEvent events[PROJECTILE_CAPACITY];
+    int idleGridStorage[GRID_STORAGE_INTS(MAX_PLAYERS)];
+
+    // InitGame: the cells ships were placed on, open addressing over
+    // 2 * playerCount slots, each a cell index + 1 (0 when empty)
+    int taken[2 * MAX_PLAYERS];
+} SimScratch;
+
+static pthread_once_t scratchOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t scratchKey;
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static void InitMap(GameMap *map);
+static void BuildFireRange(GameMap *map);
+static void InitShip(Ship *ship, int startX, int startY);
+static void PlaceShip(GameState *game, int player, int *taken, bool *full);
+static bool TakeCell(int *taken, int slots, int cell);
+static void NamePlayer(char *name, int number);
+static void FireProjectile(GameState *game, int player);
+static void HashInt(unsigned long long *hash, int value);
+static const OccupancyGrid *GridShips(const GameState *game, int afloat, OccupancyGrid *grid,
+                                      int *storage);
+static int TargetAt(const GameState *game, const OccupancyGrid *ships,
+                    int x, int y, int owner);
+static void SortHits(const int *key, const int *in, int *out, int hits, int players,
+                     int *start);
+static SimScratch *Scratch(void);
+static void CreateScratchKey(void);
+static int NextImpact(const GameState *game, const OccupancyGrid *ships, int index);
+static int ScanImpact(const GameState *game, int index, int first);
+static int CountAfloat(const GameState *game);
+static void RetireSunkShips(GameState *game);
+
+// ---------------------------------------------------------------------
+//  InitGame
+// ---------------------------------------------------------------------
+void InitGame(GameState *game, const GameMap *map, int playerCount)
+{
+    if (playerCount < 2)
+        playerCount = 2;
+    if (playerCount > MAX_PLAYERS)
+        playerCount = MAX_PLAYERS;
+
+    memset(game, 0, sizeof(GameState));
+    game->playerCount = playerCount;
+    game->map = map;
+
+    int *taken = Scratch()->taken;
+    memset(taken, 0, sizeof(int) * 2 * (size_t)playerCount);
+    bool full = false;
+    for (int i = 0; i < game->playerCount; i++)
+        PlaceShip(game, i, taken, &full);
+    ProjectilesClear(&game->projectiles);
+
+    game->gameOver = false;
+}
+
+// ---------------------------------------------------------------------
+//  MapCreate / MapFree
+//    Header, bitboard, line-of-fire table and cells in one block, the
+//    widest elements first so each array stays aligned
+// ---------------------------------------------------------------------
+GameMap *MapCreate(int width, int height)
+{
+    if (width < MIN_MAP_SIZE || width > MAX_MAP_SIZE ||
+        height < MIN_MAP_SIZE || height > MAX_MAP_SIZE)
+        return NULL;
+
+    int rowWords = (width + 2 + 31) / 32;
+    size_t solidWords = (size_t)(height + 2) * (size_t)rowWords;
+    size_t cellCount = (size_t)width * (size_t)height;
+
+    GameMap *map = malloc(sizeof(GameMap) + solidWords * sizeof(unsigned int) +
+                          cellCount * 8 * sizeof(unsigned short) + cellCount);
+    if (map == NULL)
+        return NULL;
+
+    map->width = width;
+    map->height = height;
+    map->solidRowBits = rowWords * 32;
+    map->solid = (unsigned int *)(map + 1);
+    map->fireRange = (unsigned short *)(map->solid + solidWords);
+    map->cells = (char *)(map->fireRange + cellCount * 8);
+    map->revision = 0;
+
+    InitMap(map);
+    return map;
+}
+
+void MapFree(GameMap *map)
+{
+    free(map);
+}
+
+// ---------------------------------------------------------------------
+//  Map / Ship / Projectile
+// ---------------------------------------------------------------------
+static void InitMap(GameMap *map)
+{
+    int width = map->width;
+    int height = map->height;
+
+    for (int r = 0; r < height; r++)
+    {
+        char *row = map->cells + (long)r * width;
+        for (int c = 0; c < width; c++)
+        {
+            if (r == 0 || r == height - 1 || c == 0 || c == width - 1)
+                row[c] = '#'; // boundary
+            else
+                row[c] = '.';
+        }
+    }
+
+    // Some obstacles, where they fit inside the boundary and clear of
+    // the ships' start cells
+    static const int obstacles[][2] = {{5, 3}, {8, 5}, {10, 6}};
+    for (int i = 0; i < (int)(sizeof(obstacles) / sizeof(obstacles[0])); i++)
+    {
+        int c = obstacles[i][0];
+        int r = obstacles[i][1];
+        bool inside = c < width - 1 && r < height - 1;
+        bool start = (c == 2 && r == 2) || (c == width - 2 && r == height - 2);
+        if (inside && !start)
+            map->cells[(long)r * width + c] = 'X';
+    }
+
+    BuildSolidMap(map);
+}
+
+// ---------------------------------------------------------------------
+//  BuildSolidMap
+//    Pack '#' / 'X' cells into the bitboard, border bits all solid
+//    (as are the unused padding bits past the right border)
+// ---------------------------------------------------------------------
+void BuildSolidMap(GameMap *map)
+{
+    int width = map->width;
+    int rowWords = map->solidRowBits / 32;
+
+    // Start all solid (border rows/columns), then clear open water.
+    // Each word is built in a local so the compiler can keep it in a
+    // register (char map reads may alias the bitboard otherwise).
+    map->revision++;
+    memset(map->solid, 0xFF, (size_t)(map->height + 2) * rowWords * sizeof(unsigned int));
+    for (int r = 0; r < map->height; r++)
+    {
+        const char *cells = map->cells + (long)r * width;
+        unsigned int *words = map->solid + (long)(r + 1) * rowWords;
+        for (int w = 0; w < rowWords; w++)
+        {
+            // Row bit 0 is the left border, so cell c sits at bit c + 1
+            int first = (w == 0) ? 0 : w * 32 - 1;
+            int last = (w * 32 + 31 < width) ? w * 32 + 31 : width;
+            unsigned int bits = 0xFFFFFFFFu;
+            for (int c = first; c < last; c++)
+            {
+                unsigned int open = (cells[c] != '#') & (cells[c] != 'X');
+                bits &= ~(open << (c + 1 - w * 32));
+            }
+            words[w] = bits;
+        }
+    }
+
+    BuildFireRange(map);
+}
+
+// ---------------------------------------------------------------------
+//  BuildFireRange
+//    A cell's range in a direction is 0 if the next cell is solid, else
+//    one more than the next cell's. Walking the rows and columns against
+//    the direction fills every next cell before the cell that needs it.
+// ---------------------------------------------------------------------
+static void BuildFireRange(GameMap *map)
+{
+    int width = map->width;
+    int height = map->height;
+
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            if (dx == 0 && dy == 0)
+                continue;
+            int slot = FireDirection(dx, dy);
+
+            for (int i = 0; i < height; i++)
+            {
+                int y = (dy > 0) ? height - 1 - i : i;
+                for (int j = 0; j < width; j++)
+                {
+                    int x = (dx > 0) ? width - 1 - j : j;
+                    int nx = x + dx;
+                    int ny = y + dy;
+                    unsigned short range = 0;
+                    if (!SolidAt(map, nx, ny))
+                        range = map->fireRange[((long)ny * width + nx) * 8 + slot] + 1;
+                    map->fireRange[((long)y * width + x) * 8 + slot] = range;
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+//  InLineOfFire
+// ---------------------------------------------------------------------
+bool InLineOfFire(const GameMap *map, int x, int y, int targetX, int targetY)
+{
+    int ox = targetX - x;
+    int oy = targetY - y;
+    int ax = abs(ox);
+    int ay = abs(oy);
+    if ((ax == 0 && ay == 0) || (ax != 0 && ay != 0 && ax != ay))
+        return false;
+
+    int steps = (ax > ay) ? ax : ay;
+    int dx = (ox > 0) - (ox < 0);
+    int dy = (oy > 0) - (oy < 0);
+    return steps <= FireRange(map, x, y, dx, dy);
+}
+
+static void InitShip(Ship *ship, int startX, int startY)
+{
+    ship->x = startX;
+    ship->y = startY;
+    ship->hp = SHIP_HP;
+    ship->vx = 0;
+    ship->vy = 0;
+    ship->sunk = false;
+}
+
+// "Player<number>"; by hand, as snprintf would cost more than naming
+// is worth
+static void NamePlayer(char *name, int number)
+{
+    char digits[12];
+    int count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + number % 10);
+        number /= 10;
+    } while (number > 0);
+
+    memcpy(name, "Player", 6);
+    for (int d = 0; d < count; d++)
+        name[6 + d] = digits[count - 1 - d];
+    name[6 + count] = '\0';
+}
+
+// Players 1 and 2 in the corners, as in a duel. Everyone else from a
+// fixed stride through the open water (so they spread out), skipping
+// rocks and cells already taken; a map too crowded for that gets
+// shared cells rather than no game. `taken` holds the cells of the
+// ships placed so far, so each placement is O(1) unless the water is
+// nearly full, and once it is full (*full) nobody searches it again.
+static void PlaceShip(GameState *game, int player, int *taken, bool *full)
+{
+    const GameMap *map = game->map;
+    Ship *ship = &game->ships[player];
+    int slots = 2 * game->playerCount;
+    int x = 2, y = 2;
+
+    if (player == 1)
+    {
+        x = map->width - 2;
+        y = map->height - 2;
+    }
+    else if (player > 1 && !*full)
+    {
+        int innerWidth = map->width - 2;
+        long inner = (long)innerWidth * (map->height - 2);
+        long k = ((long)player * 7919) % inner;
+        for (long tries = 0; tries < inner; tries++, k = (k + 1) % inner)
+        {
+            int cx = 1 + (int)(k % innerWidth);
+            int cy = 1 + (int)(k / innerWidth);
+            if (MapCell(map, cx, cy) == '.' && TakeCell(taken, slots, cy * map->width + cx))
+            {
+                InitShip(ship, cx, cy);
+                return;
+            }
+        }
+        *full = true;
+    }
+    TakeCell(taken, slots, y * map->width + x);
+    InitShip(ship, x, y);
+}
+
+// Add `cell` to the set; false if it was already there
+static bool TakeCell(int *taken, int slots, int cell)
+{
+    int i = (int)(((unsigned int)cell * 2654435761u) % (unsigned int)slots);
+    while (taken[i] != 0)
+    {
+        if (taken[i] == cell + 1)
+            return false;
+        i = (i + 1 == slots) ? 0 : i + 1;
+    }
+    taken[i] = cell + 1;
+    return true;
+}
+
+// ---------------------------------------------------------------------
+//  SimStep
+//    One full simulation tick: input -> ships -> projectiles -> hits
+// ---------------------------------------------------------------------
+void SimStep(GameState *game, const InputFrame *input)
+{
+    if (game->gameOver)
+        return;
+
+    // 1) Apply this tick's input -> movement & firing
+    ApplyInput(game, input);
+
+    // 2) Update ships
+    UpdateShips(game);
+
+    // 3) Update projectiles
+    UpdateProjectiles(game);
+
+    // 4) Check hits
+    CheckHits(game);
+}
+
+// ---------------------------------------------------------------------
+//  SimIdle
+//    After one real tick every ship afloat has stopped, so nothing
+//    changes until some projectile's next impact. The queue holds each
+//    projectile's impact tick; the flight up to the earliest is one
+//    ProjectilesFly, and that tick itself a real SimStep, so hits and
+//    removals follow the exact per-tick rules.
+// ---------------------------------------------------------------------
+int SimIdle(GameState *game, int ticks)
+{
+    if (ticks <= 0 || game->gameOver)
+        return 0;
+
+    InputFrame none;
+    memset(&none, 0, sizeof(InputFrame));
+    SimStep(game, &none);
+    int done = 1;
+
+    // The ships stay put from here on, so one grid of them serves every
+    // impact search; a ship that sinks is skipped, not removed
+    SimScratch *scratch = Scratch();
+    OccupancyGrid grid;
+    const OccupancyGrid *ships = GridShips(game, CountAfloat(game), &grid,
+                                           scratch->idleGridStorage);
+
+    ProjectileStore *store = &game->projectiles;
+    EventQueue queue;
+    EventQueueInit(&queue, scratch->events, PROJECTILE_CAPACITY);
+    for (int i = 0; i < store->count; i++)
+        EventPush(&queue, done + NextImpact(game, ships, i), store->id[i]);
+
+    while (done < ticks && !game->gameOver)
+    {
+        // A queued tick is never late, only early: the ship it was due
+        // to hit may have sunk since. Recheck the top until it holds.
+        // Nobody fires, so an id still in flight is the same projectile.
+        int next = ticks + 1;
+        while (queue.count > 0)
+        {
+            ScheduledEvent first = EventPeek(&queue);
+            int i = ProjectileIndex(store, first.id);
+            if (i < 0)
+            {
+                EventPop(&queue);
+                continue;
+            }
+            int due = done + NextImpact(game, ships, i);
+            if (due == first.tick)
+            {
+                next = due;
+                break;
+            }
+            EventPop(&queue);
+            EventPush(&queue, due, first.id);
+        }
+
+        int skip = ((next - 1 < ticks) ? next - 1 : ticks) - done;
+        ProjectilesFly(store, skip);
+        done += skip;
+        if (done < ticks)
+        {
+            SimStep(game, &none);
+            done++;
+        }
+    }
+    return done;
+}
+
+// Ticks from now until projectile `index` hits a ship (none of them
+// move while idle) or, the tick after its lifetime runs out, the wall.
+// Only ships on its line and ahead of it can be hit: with a grid of the
+// ships the cells up to the wall are looked at when they are fewer
+// than the ships, else (or in a crowded cell) every ship is.
+static int NextImpact(const GameState *game, const OccupancyGrid *ships, int index)
+{
+    const ProjectileStore *store = &game->projectiles;
+    int first = store->life[index] + 1;
+    if (ships == NULL || first > game->playerCount)
+        return ScanImpact(game, index, first);
+
+    int owner = store->owner[index];
+    for (int steps = 1; steps < first; steps++)
+    {
+        int here[4];
+        int count = GridQueryCell(ships, store->x[index] + store->dx[index] * steps,
+                                  store->y[index] + store->dy[index] * steps, here, 4);
+        if (count > 4)
+            return ScanImpact(game, index, first);
+        for (int k = 0; k < count; k++)
+        {
+            if (here[k] != owner && !game->ships[here[k]].sunk)
+                return steps;
+        }
+    }
+    return first;
+}
+
+// NextImpact by testing every ship, `first` if none is hit sooner
+static int ScanImpact(const GameState *game, int index, int first)
+{
+    const ProjectileStore *store = &game->projectiles;
+    int x = store->x[index];
+    int y = store->y[index];
+    int dx = store->dx[index];
+    int dy = store->dy[index];
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *ship = &game->ships[i];
+        if (i == store->owner[index] || ship->sunk)
+            continue;
+        int steps = (dx != 0) ? (ship->x - x) * dx : (ship->y - y) * dy;
+        if (steps >= 1 && steps < first && ship->x == x + dx * steps && ship->y == y + dy * steps)
+            first = steps;
+    }
+    return first;
+}
+
+// ---------------------------------------------------------------------
+//  CopyGameState
+//    The header and the ships in play are one block at the start of the
+//    struct; the pool copies its live lanes
+// ---------------------------------------------------------------------
+void CopyGameState(GameState *dst, const GameState *src)
+{
+    memcpy(dst, src, offsetof(GameState, ships) + sizeof(Ship) * (size_t)src->playerCount);
+    ProjectilesCopy(&dst->projectiles, &src->projectiles, src->playerCount);
+}
+
+// ---------------------------------------------------------------------
+//  InitRoster
+// ---------------------------------------------------------------------
+void InitRoster(Roster *roster, int playerCount)
+{
+    if (playerCount > MAX_PLAYERS)
+        playerCount = MAX_PLAYERS;
+    for (int i = 0; i < playerCount; i++)
+        NamePlayer(roster->names[i], i + 1);
+}
+
+// ---------------------------------------------------------------------
+//  ShipsOnMap
+// ---------------------------------------------------------------------
+bool ShipsOnMap(const GameState *game)
+{
+    const GameMap *map = game->map;
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *ship = &game->ships[i];
+        if (!ship->sunk &&
+            (ship->x < 0 || ship->x >= map->width || ship->y < 0 || ship->y >= map->height))
+            return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------
+//  MatchWinner
+// ---------------------------------------------------------------------
+int MatchWinner(const GameState *game)
+{
+    int winner = 0;
+    for (int i = 1; i < game->playerCount; i++)
+    {
+        if (game->ships[i].hp > game->ships[winner].hp)
+            winner = i;
+    }
+    return (game->ships[winner].hp > 0) ? winner : -1;
+}
+
+// ---------------------------------------------------------------------
+//  HashGameState
+//    FNV-1a over the values that change from tick to tick
+// ---------------------------------------------------------------------
+unsigned long long HashGameState(const GameState *game)
+{
+    unsigned long long hash = 1469598103934665603ULL;
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *ship = &game->ships[i];
+        HashInt(&hash, ship->x);
+        HashInt(&hash, ship->y);
+        HashInt(&hash, ship->hp);
+        HashInt(&hash, ship->vx);
+        HashInt(&hash, ship->vy);
+    }
+
+    // Pool order, not ids: ids are bookkeeping that snapshots renumber
+    const ProjectileStore *store = &game->projectiles;
+    HashInt(&hash, store->count);
+    for (int i = 0; i < store->count; i++)
+    {
+        HashInt(&hash, store->owner[i]);
+        HashInt(&hash, store->x[i]);
+        HashInt(&hash, store->y[i]);
+        HashInt(&hash, store->dx[i]);
+        HashInt(&hash, store->dy[i]);
+    }
+
+    HashInt(&hash, game->gameOver);
+    return hash;
+}
+
+static void HashInt(unsigned long long *hash, int value)
+{
+    unsigned int v = (unsigned int)value;
+    for (int b = 0; b < 4; b++)
+    {
+        *hash ^= (v >> (b * 8)) & 0xFFu;
+        *hash *= 1099511628211ULL;
+    }
+}
+
+// ---------------------------------------------------------------------
+//  ApplyInput
+//    Set each player’s vx, vy from the input bits and
+//    possibly spawn projectiles
+// ---------------------------------------------------------------------
+void ApplyInput(GameState *game, const InputFrame *input)
+{
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        Ship *ship = &game->ships[i];
+        unsigned char keys = input->keys[i];
+        if (ship->sunk)
+            continue;
+
+        // Reset velocities each tick
+        ship->vx = 0;
+        ship->vy = 0;
+
+        if (keys & INPUT_UP)
+            ship->vy = -MAX_SPEED;
+        if (keys & INPUT_DOWN)
+            ship->vy = MAX_SPEED;
+        if (keys & INPUT_LEFT)
+            ship->vx = -MAX_SPEED;
+        if (keys & INPUT_RIGHT)
+            ship->vx = MAX_SPEED;
+
+        if (keys & INPUT_FIRE)
+            FireProjectile(game, i);
+    }
+}
+
+static void FireProjectile(GameState *game, int player)
+{
+    const Ship *ship = &game->ships[player];
+    int dx = ship->vx;
+    int dy = ship->vy;
+    if (dx == 0 && dy == 0)
+        dy = -1; // default shoot upward if still
+
+    ProjectileFire(&game->projectiles, game->map, player, ship->x, ship->y, dx, dy);
+}
+
+// ---------------------------------------------------------------------
+//  UpdateShips
+//    - Attempt to move each ship in the direction of (vx, vy)
+//    - Check collision with obstacles
+//    - The match ends when at most one ship is left afloat
+// ---------------------------------------------------------------------
+void UpdateShips(GameState *game)
+{
+    int afloat = CountAfloat(game);
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        Ship *ship = &game->ships[i];
+        if (ship->sunk)
+            continue;
+
+        int nx = ship->x + ship->vx;
+        int ny = ship->y + ship->vy;
+
+        // Collisions with map boundary or obstacle
+        if (SolidAt(game->map, nx, ny))
+        {
+            // Collide: lose 1 HP, do not move
+            ship->hp--;
+            if (ship->hp == 0 && --afloat <= 1)
+                game->gameOver = true;
+        }
+        else
+        {
+            // No collision, update ship position
+            ship->x = nx;
+            ship->y = ny;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+//  UpdateProjectiles
+// ---------------------------------------------------------------------
+void UpdateProjectiles(GameState *game)
+{
+    ProjectilesAdvance(&game->projectiles);
+}
+
+// ---------------------------------------------------------------------
+//  CheckHits
+//    - For each projectile, see if it hits a ship other than its
+//      owner's, resolving by owner (player 1's shots first), then by
+//      target, whatever order the pool holds them in
+//    - Big fleets are put in an occupancy grid once per tick, so the
+//      pass costs O(ships + projectiles) instead of testing every pair
+// ---------------------------------------------------------------------
+void CheckHits(GameState *game)
+{
+    int afloat = CountAfloat(game);
+
+    // Nobody left to hit
+    if (afloat == 0)
+    {
+        game->gameOver = true;
+        RetireSunkShips(game);
+        return;
+    }
+
+    // A few ships are cheaper to scan than to grid (see the entities-N
+    // rows of monomaxia_bench)
+    SimScratch *scratch = Scratch();
+    OccupancyGrid grid;
+    const OccupancyGrid *ships = GridShips(game, afloat, &grid, scratch->gridStorage);
+
+    // This tick's hits, numbered in pool order
+    ProjectileStore *store = &game->projectiles;
+    int *hitIndex = scratch->hitIndex;
+    int *hitOwner = scratch->hitOwner;
+    int *hitTarget = scratch->hitTarget;
+    int hits = 0;
+    for (int i = 0; i < store->count; i++)
+    {
+        int target = TargetAt(game, ships, store->x[i], store->y[i], store->owner[i]);
+        if (target < 0)
+            continue;
+        hitIndex[hits] = i;
+        hitOwner[hits] = store->owner[i];
+        hitTarget[hits] = target;
+        hits++;
+    }
+    if (hits == 0)
+    {
+        RetireSunkShips(game);
+        return;
+    }
+
+    // By target, then (stable) by owner: the slot order the per-ship
+    // projectiles had, so a tick of mutual kills still spares player 1
+    int *order = scratch->order;
+    for (int h = 0; h < hits; h++)
+        order[h] = h;
+    SortHits(hitTarget, order, scratch->byTarget, hits, game->playerCount, scratch->sortStart);
+    SortHits(hitOwner, scratch->byTarget, order, hits, game->playerCount, scratch->sortStart);
+
+    unsigned int *spent = scratch->spent;
+    memset(spent, 0, sizeof(unsigned int) * (size_t)((store->count + 31) / 32));
+    bool decided = false;
+    for (int k = 0; k < hits && !decided; k++)
+    {
+        int h = order[k];
+        Ship *ship = &game->ships[hitTarget[h]];
+        ship->hp--;
+        spent[hitIndex[h] / 32] |= 1u << (hitIndex[h] % 32);
+        if (ship->hp == 0)
+            afloat--;
+        if (ship->hp <= 0 && afloat <= 1)
+            decided = true;
+    }
+    if (decided)
+        game->gameOver = true;
+
+    // Highest index first, so the projectile swapped into a hole has
+    // already been looked at
+    for (int i = store->count - 1; i >= 0; i--)
+    {
+        if (spent[i / 32] & (1u << (i % 32)))
+            ProjectileRemove(store, i);
+    }
+
+    RetireSunkShips(game);
+}
+
+// Stable counting sort of the hit numbers in `in` by key[hit], which
+// is a player 0 .. players - 1; `start` has room for players + 1 counts
+static void SortHits(const int *key, const int *in, int *out, int hits, int players,
+                     int *start)
+{
+    for (int p = 0; p <= players; p++)
+        start[p] = 0;
+    for (int k = 0; k < hits; k++)
+        start[key[in[k]] + 1]++;
+    for (int p = 0; p < players; p++)
+        start[p + 1] += start[p];
+    for (int k = 0; k < hits; k++)
+        out[start[key[in[k]]]++] = in[k];
+}
+
+// The ships in play gridded into `grid` over `storage`, or NULL when
+// `afloat` is few enough to scan
+static const OccupancyGrid *GridShips(const GameState *game, int afloat, OccupancyGrid *grid,
+                                      int *storage)
+{
+    if (afloat <= GRID_MIN_SHIPS)
+        return NULL;
+
+    GridInit(grid, storage, MAX_PLAYERS);
+    GridBegin(grid, game->map, afloat);
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *ship = &game->ships[i];
+        if (!ship->sunk)
+            GridAdd(grid, i, ship->x, ship->y);
+    }
+    GridFinish(grid);
+    return grid;
+}
+
+// Lowest-numbered ship in play on (x, y) other than `owner`, or -1.
+// From the grid when there is one, else by scanning the ships.
+static int TargetAt(const GameState *game, const OccupancyGrid *ships,
+                    int x, int y, int owner)
+{
+    if (ships != NULL)
+    {
+        // The first two ships here are enough to skip the owner
+        int here[2];
+        int count = GridQueryCell(ships, x, y, here, 2);
+        if (count > 0 && here[0] != owner)
+            return here[0];
+        return (count > 1) ? here[1] : -1;
+    }
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *ship = &game->ships[i];
+        if (i != owner && !ship->sunk && ship->x == x && ship->y == y)
+            return i;
+    }
+    return -1;
+}
+
+// Ships still in play with HP left
+static int CountAfloat(const GameState *game)
+{
+    int afloat = 0;
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *ship = &game->ships[i];
+        if (!ship->sunk && ship->hp > 0)
+            afloat++;
+    }
+    return afloat;
+}
+
+// End of tick: ships that ran out of HP leave play
+static void RetireSunkShips(GameState *game)
+{
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        if (game->ships[i].hp <= 0)
+            game->ships[i].sunk = true;
+    }
+}
+
+// ---------------------------------------------------------------------
+//  RandomInput
+//    Random key bits per player; fire roughly one tick in eight
+// ---------------------------------------------------------------------
+void RandomInput(unsigned int *seed, InputFrame *input, int playerCount)
+{
+    memset(input, 0, sizeof(InputFrame));
+    for (int i = 0; i < playerCount; i++)
+    {
+        unsigned int x = *seed;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *seed = x;
+
+        unsigned char keys = (unsigned char)(x & (INPUT_UP | INPUT_DOWN |
+                                                  INPUT_LEFT | INPUT_RIGHT));
+        if (((x >> 8) & 7) == 0)
+            keys |= INPUT_FIRE;
+        input->keys[i] = keys;
+    }
+}
+
+// ---------------------------------------------------------------------
+//  Scratch
+//    The calling thread's SimScratch, allocated on first use and freed
+//    when the thread exits. Nothing in it outlives one call.
+// ---------------------------------------------------------------------
+static SimScratch *Scratch(void)
+{
+    pthread_once(&scratchOnce, CreateScratchKey);
+    SimScratch *scratch = pthread_getspecific(scratchKey);
+    if (scratch == NULL)
+    {
+        // A tick cannot be half done, and nothing else can run without it
+        scratch = malloc(sizeof(SimScratch));
+        if (scratch == NULL || pthread_setspecific(scratchKey, scratch) != 0)
+        {
+            fprintf(stderr, "Out of memory for the simulation scratch\n");
+            abort();
+        }
+    }
+    return scratch;
+}
+
+static void CreateScratchKey(void)
+{
+    if (pthread_key_create(&scratchKey, free) != 0)
+    {
+        fprintf(stderr, "Cannot create the simulation scratch key\n");
+        abort();
+    }
+}
@@ -0,0 +1,301 @@
+/*
+ * simulation.h
+ *
+ * Headless "Monomaxia" simulation core. Pure C, no raylib dependency,
+ * so a GameState can be stepped without opening a window (tools,
+ * servers, load tests). Rendering and keyboard polling live in
+ * monomaxia.c and only talk to the simulation through SimStep().
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdbool.h>
+
+// ---------------------------------------------------------------------
+//  Constants
+// ---------------------------------------------------------------------
+// Map size is chosen at runtime (MapCreate), within these bounds
+#define DEFAULT_MAP_WIDTH 20
+#define DEFAULT_MAP_HEIGHT 10
+#define MIN_MAP_SIZE 5 // Either side, in cells
+#define MAX_MAP_SIZE 4096
+
+// Players per match are chosen at runtime (InitGame), up to
+// MAX_PLAYERS. The cap sizes every GameState, so it is a compile-time
+// setting: build with e.g. -DMAX_PLAYERS=1024 for big free-for-alls.
+#define DEFAULT_PLAYERS 2
+#ifndef MAX_PLAYERS
+#define MAX_PLAYERS 8
+#endif
+
+// Projectiles one ship may have in flight. May be overridden at
+// compile time (e.g. -DMAX_PROJECTILES=16) to benchmark busier matches
+#ifndef MAX_PROJECTILES
+#define MAX_PROJECTILES 5
+#endif
+
+// Size of the projectile pool all ships share. By default it never
+// runs dry before the per-ship limit does; a smaller pool (e.g.
+// -DPROJECTILE_CAPACITY=256 with thousands of players) trades that
+// guarantee for a smaller GameState.
+#ifndef PROJECTILE_CAPACITY
+#define PROJECTILE_CAPACITY (MAX_PLAYERS * MAX_PROJECTILES)
+#endif
+
+// Pool arrays, rounded up to whole 8-lane SIMD blocks
+#define PROJECTILE_LANES ((PROJECTILE_CAPACITY + 7) & ~7)
+
+#define MAX_SPEED 1 // Movement speed (in cells) per frame
+#define SHIP_HP 3   // Hit points every ship starts with
+
+// Input bits, one byte per player per tick
+#define INPUT_UP 0x01
+#define INPUT_DOWN 0x02
+#define INPUT_LEFT 0x04
+#define INPUT_RIGHT 0x08
+#define INPUT_FIRE 0x10
+
+// ---------------------------------------------------------------------
+//  Structs
+// ---------------------------------------------------------------------
+
+// The projectile pool shared by every ship. Live projectiles are packed
+// into [0, count), structure-of-arrays so the movement kernels in
+// projectiles.c can process 8 per instruction; removing one moves the
+// last into its place. Each also carries an id that stays the same
+// while it flies (positions do not), handed out from a free list.
+typedef struct
+{
+    int x[PROJECTILE_LANES];  // Position in map cells
+    int y[PROJECTILE_LANES];
+    int dx[PROJECTILE_LANES]; // Movement direction
+    int dy[PROJECTILE_LANES];
+    int life[PROJECTILE_LANES];  // Steps left before '#' / 'X' (FireRange)
+    int owner[PROJECTILE_LANES]; // Player who fired it
+    int id[PROJECTILE_LANES];
+    int count;                   // Live projectiles
+
+    int indexOf[PROJECTILE_CAPACITY];  // Position of each live id
+    int nextFree[PROJECTILE_CAPACITY]; // Free id list links
+    int freeHead;                      // First free id, -1 if none
+    int issued;                        // Ids from here on never used yet
+    int inFlight[MAX_PLAYERS];         // Live projectiles per owner
+} ProjectileStore;
+
+// Everything in here is read every tick, so it is kept small: ten
+// bytes, six ships to a cache line. Positions fit in a short as maps
+// are at most MAX_MAP_SIZE a side, and so does hp however many hits
+// land in one tick (at most one per projectile in the pool).
+typedef struct
+{
+    short x, y; // Position (map cells)
+    short hp;   // “Health” points
+    // Movement each frame (set by input), -MAX_SPEED .. MAX_SPEED
+    signed char vx, vy;
+    // Out of the match: hp reached 0 in an earlier tick. Between ticks
+    // this is always hp <= 0; a ship sinking mid-tick stays in play
+    // (and can still be hit) until the tick ends.
+    bool sunk;
+} Ship;
+
+// The bay: '#' boundary, 'X' obstacle, '.' water, row major, plus the
+// solidity bitboard built from it (one bit per cell, set for '#' and
+// 'X'). The bitboard is framed by a solid one-cell border, so cells -1
+// and width / height can be tested without a bounds check (nothing
+// moves more than one cell). Along with it, the line-of-fire table:
+// for every cell and each of the 8 directions, how many open cells
+// follow before the first solid one (16 bytes a cell), so how far a
+// shot flies is a lookup, not a walk.
+//
+// Created at runtime by MapCreate() as a single allocation. The map
+// never changes during a match, so every GameState playing on it
+// (current and previous tick, a whole batch of matches) shares it.
+// Whatever is derived from the cells (paths.h) notes the revision it
+// was built from, which BuildSolidMap bumps on every edit.
+typedef struct
+{
+    int width, height;   // In cells
+    unsigned int revision;
+    int solidRowBits;    // Bitboard row stride: width + 2, rounded up to 32
+    unsigned int *solid; // (height + 2) rows of solidRowBits bits
+    unsigned short *fireRange; // width * height cells of 8 (FireDirection)
+    char *cells;         // width * height
+} GameMap;
+
+// Display names of the players. Like the map they never change during
+// a match, so they are not part of the GameState: one Roster serves
+// every state (and every match) that needs to show a name.
+#define PLAYER_NAME_SIZE 16
+
+typedef struct
+{
+    char names[MAX_PLAYERS][PLAYER_NAME_SIZE];
+} Roster;
+
+// Only what changes from tick to tick, hot fields first: the ships sit
+// in the first cache lines and the projectile pool after them. Saving a
+// tick (a rollback or history ring) is CopyGameState, which copies just
+// the ships in play and the projectiles in flight, not the whole pool.
+typedef struct
+{
+    int playerCount; // 2 .. MAX_PLAYERS, fixed for the match
+    bool gameOver;
+    const GameMap *map; // Shared, not owned
+    Ship ships[MAX_PLAYERS];
+    ProjectileStore projectiles;
+} GameState;
+
+// One tick worth of input: INPUT_* bits for every player.
+// Fire is edge-triggered by the caller (key pressed this tick).
+typedef struct
+{
+    unsigned char keys[MAX_PLAYERS];
+} InputFrame;
+
+// ---------------------------------------------------------------------
+//  Simulation API
+// ---------------------------------------------------------------------
+// A width x height bay with the default boundary and obstacles, or
+// NULL if a side is outside MIN_MAP_SIZE .. MAX_MAP_SIZE (or no memory)
+GameMap *MapCreate(int width, int height);
+void MapFree(GameMap *map);
+
+// Rebuild map->solid and map->fireRange from map->cells; call after
+// editing the cells
+void BuildSolidMap(GameMap *map);
+
+static inline char MapCell(const GameMap *map, int x, int y)
+{
+    return map->cells[(long)y * map->width + x];
+}
+
+// Single bit test, valid for -1 <= x <= width, -1 <= y <= height
+static inline int SolidBit(const GameMap *map, int x, int y)
+{
+    return (y + 1) * map->solidRowBits + (x + 1);
+}
+
+static inline bool SolidAt(const GameMap *map, int x, int y)
+{
+    int bit = SolidBit(map, x, y);
+    return (map->solid[bit / 32] >> (bit % 32)) & 1u;
+}
+
+// Slot of direction (dx, dy), each -1 .. 1 and not both 0, in a cell's
+// 8 fireRange entries: row-major over the 3x3 square, centre skipped
+static inline int FireDirection(int dx, int dy)
+{
+    int slot = (dy + 1) * 3 + (dx + 1);
+    return slot - (slot > 4);
+}
+
+// Open cells a projectile on (x, y) heading (dx, dy) still moves
+// through before it hits '#' / 'X': its remaining lifetime in ticks
+static inline int FireRange(const GameMap *map, int x, int y, int dx, int dy)
+{
+    return map->fireRange[((long)y * map->width + x) * 8 + FireDirection(dx, dy)];
+}
+
+// Whether a shot fired from (x, y) would reach (targetX, targetY): the
+// target lies on one of the 8 lines from it, within range. O(1).
+bool InLineOfFire(const GameMap *map, int x, int y, int targetX, int targetY);
+
+// Start a match of playerCount ships (clamped to 2 .. MAX_PLAYERS) on
+// `map`, which must outlive the game. Players 1 and 2 start in
+// opposite corners, any others spread over the open water.
+void InitGame(GameState *game, const GameMap *map, int playerCount);
+
+// Advance the game by exactly one tick. Does nothing once gameOver.
+void SimStep(GameState *game, const InputFrame *input);
+
+// Advance up to `ticks` ticks with nobody steering or firing: the same
+// state as that many SimStep calls with an empty InputFrame, but only
+// the ticks where a projectile hits a ship or a wall are stepped, the
+// flight in between is one jump. Returns the ticks advanced, fewer only
+// when the match ended.
+int SimIdle(GameState *game, int ticks);
+
+// dst = src, copying only the live part: the ships of the match and
+// the projectiles in flight. Whatever dst held past that stays, and is
+// never read. Any dst will do; rings of saved ticks reuse theirs.
+void CopyGameState(GameState *dst, const GameState *src);
+
+// "Player1" .. for the first playerCount players
+void InitRoster(Roster *roster, int playerCount);
+
+// After filling the ships directly (snapshot decoding): false if a
+// ship in play stands outside the map, where no move could take it
+bool ShipsOnMap(const GameState *game);
+
+// Index of the winning player once gameOver (the last ship afloat,
+// or the one with the most HP), or -1 when every ship sank
+int MatchWinner(const GameState *game);
+
+// Hash of the per-tick state (ships, live projectiles, gameOver), built
+// from field values so it does not depend on struct layout or padding
+unsigned long long HashGameState(const GameState *game);
+
+// Individual phases of SimStep, in the order it runs them
+void ApplyInput(GameState *game, const InputFrame *input);
+void UpdateShips(GameState *game);
+void UpdateProjectiles(GameState *game);
+void CheckHits(GameState *game);
+
+// Pseudo-random input for bots, load tests and benchmarks.
+// Deterministic for a given *seed (xorshift32, seed must be non-zero).
+// Fills the first playerCount players, clears the rest.
+void RandomInput(unsigned int *seed, InputFrame *input, int playerCount);
+
+// ---------------------------------------------------------------------
+//  Projectile store (projectiles.c)
+// ---------------------------------------------------------------------
+typedef enum
+{
+    PROJECTILE_KERNEL_SCALAR,
+    PROJECTILE_KERNEL_SSE41,
+    PROJECTILE_KERNEL_AVX2
+} ProjectileKernel;
+
+// The kernel in use defaults to the best one this CPU supports.
+// Forcing SCALAR is how the SIMD paths are checked for equivalence.
+ProjectileKernel ProjectilesBestKernel(void);
+void ProjectilesSetKernel(ProjectileKernel kernel);
+const char *ProjectileKernelName(ProjectileKernel kernel);
+
+void ProjectilesClear(ProjectileStore *store);
+
+// Launch a projectile at the end of the live range, O(1), with a
+// lifetime of FireRange steps on `map`. False when the owner already
+// has MAX_PROJECTILES in flight or the pool is full.
+bool ProjectileFire(ProjectileStore *store, const GameMap *map, int owner,
+                    int x, int y, int dx, int dy);
+
+// Remove the projectile at `index`; the last one takes its place
+void ProjectileRemove(ProjectileStore *store, int index);
+
+// Where the projectile with `id` is now, or -1 if it is not in flight
+int ProjectileIndex(const ProjectileStore *store, int id);
+
+// dst = src for the live projectiles and the id bookkeeping in use
+// (see CopyGameState); per-owner counts for the first `players`
+void ProjectilesCopy(ProjectileStore *dst, const ProjectileStore *src, int players);
+
+// After filling x .. id and count directly (snapshot decoding), rebuild
+// the id index, free list and per-owner counts. False if ids repeat or
+// fall outside the pool, or an owner is over its limit.
+bool ProjectilesReindex(ProjectileStore *store);
+
+// ... and set every lifetime from `map`. False if a projectile is off
+// the map or has no direction.
+bool ProjectilesMeasure(ProjectileStore *store, const GameMap *map);
+
+// Move every live projectile one step; remove those whose lifetime ran
+// out (the next cell is '#' / 'X')
+void ProjectilesAdvance(ProjectileStore *store);
+
+// Move every live projectile `steps` steps at once. Each must have at
+// least that much lifetime left, so none is removed on the way.
+void ProjectilesFly(ProjectileStore *store, int steps);
+
+#endif // SIMULATION_H
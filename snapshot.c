@@ -0,0 +1,385 @@
+/*
+ * snapshot.c
+ *
+ * Bitpacked full and delta snapshots (see snapshot.h).
+ *
+ * Layout after the header byte (version << 1 | delta):
+ *    gameOver                              1 bit
+ *    per player, full:
+ *        x, y                              XY bits each
+ *        hp                                zigzag varint, 3-bit groups
+ *        vx + 1, vy + 1                    2 bits each
+ *    per player, delta: 1 "changed" bit, then if set
+ *        vx + 1, vy + 1                    2 bits each
+ *        position code                     2 bits: stayed / moved by
+ *                                          (vx, vy) / x, y follow
+ *        hp changed bit [+ hp varint]
+ *    projectile count                      POOL bits
+ *    full:  per projectile: id, owner, x, y, dx+1, dy+1
+ *    delta: per projectile below the base's count, 1 "advanced" bit
+ *           (same projectile as the base's at that position, moved by
+ *           its own dx, dy); past it or if not advanced, the full record
+ *
+ * Decoding rebuilds the pool's id index and free list (which ids are
+ * handed out next is bookkeeping, not game state).
+ */
+
+#include "snapshot.h"
+
+#include <string.h>
+
+// ---------------------------------------------------------------------
+//  Structs
+// ---------------------------------------------------------------------
+
+typedef struct
+{
+    unsigned char *buf;
+    size_t capacity; // in bytes
+    size_t bit;
+    bool overflow;
+} BitWriter;
+
+typedef struct
+{
+    const unsigned char *buf;
+    size_t length; // in bytes
+    size_t bit;
+    bool failed; // Ran past the end or hit an invalid code
+} BitReader;
+
+// ---------------------------------------------------------------------
+//  Forward Declarations
+// ---------------------------------------------------------------------
+static int BitsFor(int maxValue);
+static void PutBits(BitWriter *w, unsigned int value, int count);
+static unsigned int GetBits(BitReader *r, int count);
+static void PutVarint(BitWriter *w, int value);
+static int GetVarint(BitReader *r);
+static void PutShip(BitWriter *w, const Ship *ship, int bitsX, int bitsY);
+static void GetShip(BitReader *r, Ship *ship, int bitsX, int bitsY);
+static void PutShipDelta(BitWriter *w, const Ship *ship, const Ship *base,
+                         int bitsX, int bitsY);
+static void GetShipDelta(BitReader *r, Ship *ship, int bitsX, int bitsY);
+static void PutProjectile(BitWriter *w, const ProjectileStore *store, int i,
+                          int bitsX, int bitsY, int playerCount);
+static void GetProjectile(BitReader *r, ProjectileStore *store, int i,
+                          int bitsX, int bitsY, int playerCount);
+static signed char GetVelocity(BitReader *r);
+static bool SameShip(const Ship *a, const Ship *b);
+static bool Advanced(const ProjectileStore *base, const ProjectileStore *store, int i);
+
+// ---------------------------------------------------------------------
+//  SnapshotEncode
+// ---------------------------------------------------------------------
+size_t SnapshotEncode(const GameState *game, const GameState *base,
+                      unsigned char *buf, size_t capacity)
+{
+    int bitsX = BitsFor(game->map->width - 1);
+    int bitsY = BitsFor(game->map->height - 1);
+    BitWriter w = {buf, capacity, 0, false};
+    const ProjectileStore *store = &game->projectiles;
+    int players = game->playerCount;
+
+    PutBits(&w, (SNAPSHOT_VERSION << 1) | (base != NULL), 8);
+    PutBits(&w, game->gameOver, 1);
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        const Ship *ship = &game->ships[i];
+        if (base == NULL)
+        {
+            PutShip(&w, ship, bitsX, bitsY);
+            continue;
+        }
+
+        bool changed = !SameShip(ship, &base->ships[i]);
+        PutBits(&w, changed, 1);
+        if (changed)
+            PutShipDelta(&w, ship, &base->ships[i], bitsX, bitsY);
+    }
+
+    PutBits(&w, (unsigned int)store->count, BitsFor(PROJECTILE_CAPACITY));
+    int kept = (base != NULL) ? base->projectiles.count : 0;
+    for (int i = 0; i < store->count; i++)
+    {
+        if (i < kept)
+        {
+            bool advanced = Advanced(&base->projectiles, store, i);
+            PutBits(&w, advanced, 1);
+            if (advanced)
+                continue;
+        }
+        PutProjectile(&w, store, i, bitsX, bitsY, players);
+    }
+
+    if (w.overflow)
+        return 0;
+    return (w.bit + 7) / 8;
+}
+
+// ---------------------------------------------------------------------
+//  SnapshotDecode
+// ---------------------------------------------------------------------
+bool SnapshotDecode(const unsigned char *buf, size_t length,
+                    const GameState *base, GameState *game)
+{
+    int bitsX = BitsFor(game->map->width - 1);
+    int bitsY = BitsFor(game->map->height - 1);
+    BitReader r = {buf, length, 0, false};
+
+    unsigned int header = GetBits(&r, 8);
+    bool delta = header & 1u;
+    if ((header >> 1) != SNAPSHOT_VERSION || delta != (base != NULL))
+        return false;
+
+    if (delta && base != game)
+        CopyGameState(game, base);
+    ProjectileStore *store = &game->projectiles;
+    int players = game->playerCount;
+
+    game->gameOver = GetBits(&r, 1);
+
+    for (int i = 0; i < game->playerCount; i++)
+    {
+        Ship *ship = &game->ships[i];
+        if (!delta)
+            GetShip(&r, ship, bitsX, bitsY);
+        else if (GetBits(&r, 1))
+            GetShipDelta(&r, ship, bitsX, bitsY);
+        // Snapshots are taken between ticks
+        ship->sunk = ship->hp <= 0;
+    }
+
+    // Position i is only ever rebuilt from the base's position i, which
+    // `store` still holds, so a delta decodes in place
+    int count = (int)GetBits(&r, BitsFor(PROJECTILE_CAPACITY));
+    if (count > PROJECTILE_CAPACITY)
+        return false;
+    int kept = delta ? store->count : 0;
+    for (int i = 0; i < count && !r.failed; i++)
+    {
+        if (i < kept && GetBits(&r, 1))
+        {
+            // Advanced by its own direction since the base
+            store->x[i] += store->dx[i];
+            store->y[i] += store->dy[i];
+            continue;
+        }
+        GetProjectile(&r, store, i, bitsX, bitsY, players);
+    }
+    store->count = count;
+
+    return !r.failed && ShipsOnMap(game) && ProjectilesReindex(store) &&
+           ProjectilesMeasure(store, game->map);
+}
+
+// ---------------------------------------------------------------------
+//  Field records
+// ---------------------------------------------------------------------
+static void PutShip(BitWriter *w, const Ship *ship, int bitsX, int bitsY)
+{
+    PutBits(w, (unsigned int)ship->x, bitsX);
+    PutBits(w, (unsigned int)ship->y, bitsY);
+    PutVarint(w, ship->hp);
+    PutBits(w, (unsigned int)(ship->vx + 1), 2);
+    PutBits(w, (unsigned int)(ship->vy + 1), 2);
+}
+
+static void GetShip(BitReader *r, Ship *ship, int bitsX, int bitsY)
+{
+    ship->x = (short)GetBits(r, bitsX);
+    ship->y = (short)GetBits(r, bitsY);
+    ship->hp = (short)GetVarint(r);
+    ship->vx = GetVelocity(r);
+    ship->vy = GetVelocity(r);
+}
+
+// Ships either move by their new (vx, vy) or stay put (collision), so
+// the position is usually implied by the velocity
+static void PutShipDelta(BitWriter *w, const Ship *ship, const Ship *base,
+                         int bitsX, int bitsY)
+{
+    PutBits(w, (unsigned int)(ship->vx + 1), 2);
+    PutBits(w, (unsigned int)(ship->vy + 1), 2);
+
+    if (ship->x == base->x && ship->y == base->y)
+    {
+        PutBits(w, 0, 2);
+    }
+    else if (ship->x == base->x + ship->vx && ship->y == base->y + ship->vy)
+    {
+        PutBits(w, 1, 2);
+    }
+    else
+    {
+        PutBits(w, 2, 2);
+        PutBits(w, (unsigned int)ship->x, bitsX);
+        PutBits(w, (unsigned int)ship->y, bitsY);
+    }
+
+    PutBits(w, ship->hp != base->hp, 1);
+    if (ship->hp != base->hp)
+        PutVarint(w, ship->hp);
+}
+
+// `ship` holds the base values on entry. Where it ends up is checked
+// once every ship is decoded (ShipsOnMap).
+static void GetShipDelta(BitReader *r, Ship *ship, int bitsX, int bitsY)
+{
+    ship->vx = GetVelocity(r);
+    ship->vy = GetVelocity(r);
+
+    unsigned int code = GetBits(r, 2);
+    if (code == 1)
+    {
+        ship->x += ship->vx;
+        ship->y += ship->vy;
+    }
+    else if (code == 2)
+    {
+        ship->x = (short)GetBits(r, bitsX);
+        ship->y = (short)GetBits(r, bitsY);
+    }
+    else if (code != 0)
+    {
+        r->failed = true; // Unknown code: corrupt
+    }
+
+    if (GetBits(r, 1))
+        ship->hp = (short)GetVarint(r);
+}
+
+// Codes 0 .. 2 are -1 .. 1; 3 never comes from a real match
+static signed char GetVelocity(BitReader *r)
+{
+    unsigned int code = GetBits(r, 2);
+    if (code > 2)
+        r->failed = true;
+    return (signed char)((int)code - 1);
+}
+
+static void PutProjectile(BitWriter *w, const ProjectileStore *store, int i,
+                          int bitsX, int bitsY, int playerCount)
+{
+    PutBits(w, (unsigned int)store->id[i], BitsFor(PROJECTILE_CAPACITY - 1));
+    PutBits(w, (unsigned int)store->owner[i], BitsFor(playerCount - 1));
+    PutBits(w, (unsigned int)store->x[i], bitsX);
+    PutBits(w, (unsigned int)store->y[i], bitsY);
+    PutBits(w, (unsigned int)(store->dx[i] + 1), 2);
+    PutBits(w, (unsigned int)(store->dy[i] + 1), 2);
+}
+
+// Repeated or out-of-range ids are caught by ProjectilesReindex
+static void GetProjectile(BitReader *r, ProjectileStore *store, int i,
+                          int bitsX, int bitsY, int playerCount)
+{
+    store->id[i] = (int)GetBits(r, BitsFor(PROJECTILE_CAPACITY - 1));
+    store->owner[i] = (int)GetBits(r, BitsFor(playerCount - 1));
+    if (store->owner[i] >= playerCount)
+        r->failed = true;
+    store->x[i] = (int)GetBits(r, bitsX);
+    store->y[i] = (int)GetBits(r, bitsY);
+    store->dx[i] = (int)GetBits(r, 2) - 1;
+    store->dy[i] = (int)GetBits(r, 2) - 1;
+}
+
+static bool SameShip(const Ship *a, const Ship *b)
+{
+    return a->x == b->x && a->y == b->y && a->hp == b->hp &&
+           a->vx == b->vx && a->vy == b->vy;
+}
+
+static bool Advanced(const ProjectileStore *base, const ProjectileStore *store, int i)
+{
+    return store->id[i] == base->id[i] &&
+           store->owner[i] == base->owner[i] &&
+           store->dx[i] == base->dx[i] &&
+           store->dy[i] == base->dy[i] &&
+           store->x[i] == base->x[i] + base->dx[i] &&
+           store->y[i] == base->y[i] + base->dy[i];
+}
+
+// ---------------------------------------------------------------------
+//  Bit I/O
+// ---------------------------------------------------------------------
+static int BitsFor(int maxValue)
+{
+    int bits = 1;
+    while ((maxValue >> bits) != 0)
+        bits++;
+    return bits;
+}
+
+// Bits are filled LSB first, up to a byte's worth per step
+static void PutBits(BitWriter *w, unsigned int value, int count)
+{
+    while (count > 0)
+    {
+        size_t byte = w->bit / 8;
+        if (byte >= w->capacity)
+        {
+            w->overflow = true;
+            return;
+        }
+
+        int offset = (int)(w->bit % 8);
+        int take = (8 - offset < count) ? 8 - offset : count;
+        if (offset == 0)
+            w->buf[byte] = 0;
+        w->buf[byte] |= (unsigned char)((value & ((1u << take) - 1)) << offset);
+
+        value >>= take;
+        count -= take;
+        w->bit += (size_t)take;
+    }
+}
+
+static unsigned int GetBits(BitReader *r, int count)
+{
+    unsigned int value = 0;
+    int done = 0;
+    while (done < count)
+    {
+        size_t byte = r->bit / 8;
+        if (byte >= r->length)
+        {
+            r->failed = true;
+            return 0;
+        }
+
+        int offset = (int)(r->bit % 8);
+        int take = (8 - offset < count - done) ? 8 - offset : count - done;
+        value |= ((unsigned int)(r->buf[byte] >> offset) & ((1u << take) - 1)) << done;
+
+        done += take;
+        r->bit += (size_t)take;
+    }
+    return value;
+}
+
+// Zigzag so small negative HP (overkill) stays short, then 3 value
+// bits + 1 continuation bit per group: HP 0..7 costs 4 bits
+static void PutVarint(BitWriter *w, int value)
+{
+    unsigned int zigzag = ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+    do
+    {
+        unsigned int group = zigzag & 7u;
+        zigzag >>= 3;
+        PutBits(w, group | ((zigzag != 0) << 3), 4);
+    } while (zigzag != 0);
+}
+
+static int GetVarint(BitReader *r)
+{
+    unsigned int zigzag = 0;
+    for (int shift = 0; shift < 33; shift += 3)
+    {
+        unsigned int group = GetBits(r, 4);
+        zigzag |= (group & 7u) << shift;
+        if ((group & 8u) == 0 || r->failed)
+            break;
+    }
+    return (int)(zigzag >> 1) ^ -(int)(zigzag & 1u);
+}
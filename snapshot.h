@@ -0,0 +1,44 @@
+/*
+ * snapshot.h
+ *
+ * Compact, versioned binary snapshots of the per-tick GameState, for
+ * save states, replays and network sync.
+ *
+ * Only what changes during a match is encoded: ships, projectiles and
+ * gameOver. Names, the player count and the map are match setup
+ * (InitGame) and are never sent. Fields are bitpacked: positions use
+ * just enough bits for the map size, velocities and directions 2 bits,
+ * HP a zigzag varint, and projectiles a count followed by the live
+ * ones in pool order, ids included so the receiver can follow them.
+ *
+ * A delta snapshot is encoded against a base state the receiver already
+ * has (usually the previous tick): unchanged ships cost 1 bit, and a
+ * projectile that simply advanced one step in place costs 1 bit.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+
+#include "simulation.h"
+
+#define SNAPSHOT_VERSION 2
+
+// Upper bound for any snapshot, full or delta, of a match with this
+// many players and live projectiles, and for any match of this build
+#define SnapshotMaxBytes(players, projectiles) (6 + (players) * 12 + (projectiles) * 9)
+#define SNAPSHOT_MAX_BYTES SnapshotMaxBytes(MAX_PLAYERS, PROJECTILE_CAPACITY)
+
+// Encode `game`, as a delta against `base` or as a full snapshot when
+// base is NULL. Returns the byte count, 0 if `capacity` is too small.
+size_t SnapshotEncode(const GameState *game, const GameState *base,
+                      unsigned char *buf, size_t capacity);
+
+// Decode into `game`. For a delta, `base` must be the state it was
+// encoded against; for a full snapshot `game` must already hold the
+// match setup (InitGame). Returns false on a corrupt or foreign buffer.
+bool SnapshotDecode(const unsigned char *buf, size_t length,
+                    const GameState *base, GameState *game);
+
+#endif // SNAPSHOT_H